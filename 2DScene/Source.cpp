@@ -15,7 +15,60 @@
 #include <shader.h>
 // Include the camera header
 #include <camera.h>
+// Include the mesh registry header
+#include <mesh.h>
+// Include the hash header
+#include <hash.h>
+// Include the mesh cache header
+#include <mesh_cache.h>
+// Include the trigonometry cache header
+#include <trig_cache.h>
+// Include the vertex generation kernels header
+#include <mesh_kernels.h>
+// Include the compile-time mesh header
+#include <static_mesh.h>
+// Include the thread pool header
+#include <thread_pool.h>
+// Include the instancing header
+#include <instancing.h>
+// Include the frustum culling header
+#include <frustum.h>
+// Include the draw list header
+#include <draw_list.h>
+// Include the per-frame uniform buffer header
+#include <frame_uniforms.h>
+// Include the multi-draw indirect header
+#include <indirect_draw.h>
+// Include the material texture array header
+#include <texture_array.h>
+// Include the texture streaming header
+#include <texture_stream.h>
+// Include the texture cache header
+#include <texture_cache.h>
+// Include the texture compression header
+#include <texture_compress.h>
+// Include the mip chain header
+#include <texture_mips.h>
+// Include the benchmark header
+#include <bench.h>
+// Include the microbenchmark helpers header
+#include <microbench.h>
+// Include the headless context header
+#include <egl_context.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
 #include <vector>
 
 /*
@@ -37,6 +90,7 @@ namespace
     // For view toggling
     bool isPerspective = true; // Defines starting view
     glm::mat4 projection; // Initiates projection
+    const float FAR_PLANE = 100.0f; // Far clipping plane of both views
 
     // camera
     Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -50,14 +104,24 @@ namespace
 
     float PI = glm::radians(180.0f);
 
-    // Stores the data relative to a given mesh
-    struct GLMesh
+    // Meshes held by the mesh registry, in the order createMesh adds them
+    enum MeshId
     {
-        unsigned int VAOs[14];       // Vertex array objects
-        unsigned int VBOs[14];       // Vertex buffer objects
-        unsigned int EBOs[14];       // Element buffer objects
-        unsigned int indexCounts[14]; // Index counts
-
+        MESH_CYL1_SIDE,     // first cylinder
+        MESH_CYL1_TOP,
+        MESH_CYL1_BOTTOM,
+        MESH_CYL2_SIDE,     // second cylinder
+        MESH_CYL2_TOP,
+        MESH_CYL2_BOTTOM,
+        MESH_PYRAMID,
+        MESH_PLANE,
+        MESH_SPHERE,
+        MESH_CYL3_SIDE,     // cat body
+        MESH_CONE,          // cat ears
+        MESH_CUBE,
+        MESH_CARD,
+        MESH_CYL4_SIDE,     // cotton
+        MESH_COUNT
     };
 
     // Stores RGB values for specific colors
@@ -69,36 +133,294 @@ namespace
         float alphaValue;
     };
 
-    // Sets number of verices for some objects
-    int sides = 20;
-    // Sets the rings and segments of sphere objects
-    int segments = 20;
-    int rings = 20;
+    // Levels of detail of every procedural mesh, coarsest first. A level has that many sides around
+    // cylinders, cones and caps, and that many rings and segments on spheres.
+    constexpr int LOD_COUNT = 4;
+    // Resolutions the compiler generates the levels at (see createMesh)
+    constexpr int STATIC_LOD_SIDES[LOD_COUNT] = { 8, 16, 32, 64 };
+    // Resolutions this run uses (set with --lod-sides)
+    int lodSides[LOD_COUNT] = { STATIC_LOD_SIDES[0], STATIC_LOD_SIDES[1], STATIC_LOD_SIDES[2], STATIC_LOD_SIDES[3] };
+    // Largest distance in pixels the silhouette of a level may be from the true circle
+    const float LOD_PIXEL_ERROR = 0.5f;
+    // Level every procedural mesh is drawn at, -1 picks one from the screen size (set with --lod)
+    int forcedLod = -1;
+    // Height of the viewport in pixels, for the screen size of objects
+    int viewportHeight = SCR_HEIGHT;
+    // Procedural meshes are computed in shader.vs from gl_VertexID instead of read from the VBO (set with --vertex-pulling)
+    bool vertexPulling = false;
+    // Empty vertex array the pulled meshes are drawn with
+    unsigned int pullingVAO = 0;
+
+    // Copies of a mesh are drawn with one instanced call per level of detail (turned off with --no-instancing)
+    bool instancing = true;
+    // Transforms and materials of every draw this frame, a single draw is one instance
+    InstanceBuffer instanceBuffer;
+    // View, projection and light of the current frame
+    FrameUniformBuffer frameUniforms;
+    // Extra cat spheres scattered over the plane, a stand-in for repeated props (set with --props)
+    int propCount = 0;
+    std::vector<MeshInstance> props;
+    // Instances of the cat spheres this frame, kept to reuse its storage
+    std::vector<MeshInstance> catInstances;
+
+    // Objects outside the view frustum are not drawn (turned off with --no-frustum-culling)
+    bool frustumCulling = true;
+    FrustumCuller culler;
+
+    // An object drawn with one model and material, up to three meshes tested with the bounds of the first
+    struct SceneObject
+    {
+        MeshId meshes[3];
+        int meshCount;
+        glm::mat4 model;
+        unsigned int material;
+    };
+    // Objects that are not instanced this frame, culled together before they are queued
+    std::vector<SceneObject> sceneObjects;
+
+    // Draws of the current frame, sorted by state before they are submitted
+    DrawList drawList;
+    // Instance data of every draw in the list, uploaded once per frame
+    std::vector<MeshInstance> frameInstances;
+
+    // Runs of draws that share their state are issued as one multi-draw indirect call, needs OpenGL 4.3
+    // (turned off with --no-multi-draw)
+    bool multiDrawIndirect = true;
+    // Indirect commands of the current frame, one per item of the draw list
+    IndirectBuffer indirectBuffer;
+    std::vector<DrawElementsIndirectCommand> drawCommands;
+
+    // Locations of the pulled mesh uniforms, looked up once after the shader is built
+    struct DrawUniforms
+    {
+        int shape;
+        int sides;
+        int height;
+        int radius;
+        int shapeColor;
+    };
+    DrawUniforms drawUniforms;
+
+    // Textures the materials sample, in the order createTextures resolves them
+    enum TextureId
+    {
+        TEXTURE_FUR,
+        TEXTURE_WOOD,
+        TEXTURE_CARD,
+        TEXTURE_BLACK,
+        TEXTURE_WOOD_MIRRORED,
+        TEXTURE_TIEDYE,
+        TEXTURE_LABEL,
+        TEXTURE_LID,
+        TEXTURE_COUNT
+    };
+    static_assert(TEXTURE_COUNT <= MAX_TEXTURES, "shader.fs holds layers and wrap modes for MAX_TEXTURES textures");
+    // Width and height every image is resampled to
+    const int MATERIAL_TEXTURE_SIZE = 1024;
+
+    // Image file of a texture and how it is sampled
+    struct TextureSource
+    {
+        const char* path;
+        TextureId texture;
+        TextureWrap wrap;
+        bool flip;      // flip on the y-axis while decoding
+    };
+
+    // Every material texture. Files that are the same with the same flip become one image, the
+    // wood is used with two wrap modes. The fur texture is the only one not flipped, as it always
+    // has been.
+    const TextureSource TEXTURE_SOURCES[] =
+    {
+        { "resources/FurTexture.jpg", TEXTURE_FUR, WRAP_REPEAT, false },
+        { "resources/WoodTexture.jpg", TEXTURE_WOOD, WRAP_REPEAT, true },
+        { "resources/visa.jpg", TEXTURE_CARD, WRAP_REPEAT, true },
+        { "resources/Black Texture.jpg", TEXTURE_BLACK, WRAP_REPEAT, true },
+        { "resources/WoodTexture.jpg", TEXTURE_WOOD_MIRRORED, WRAP_MIRRORED_REPEAT, true },
+        { "resources/tiedye.jpg", TEXTURE_TIEDYE, WRAP_CLAMP_TO_EDGE, true },
+        { "resources/label2.png", TEXTURE_LABEL, WRAP_CLAMP_TO_EDGE, true },
+        { "resources/lid.png", TEXTURE_LID, WRAP_REPEAT, true },
+    };
+
+    // A distinct image, its file read and waiting to be decoded into its layer of the material array
+    struct TextureImage
+    {
+        const char* path;
+        bool flip;
+        std::uint64_t key;      // see textureImageKey
+        std::vector<unsigned char> file;
+    };
+
+    // A decoded image, already resampled to the layer size, followed by its mip levels; no levels
+    // when it has a channel count the layers cannot hold
+    struct DecodedTexture
+    {
+        int layer;
+        int channels;
+        std::vector<std::vector<unsigned char>> levels;
+    };
+
+    // Materials of the cat spheres, the props alternate between them
+    constexpr unsigned int CAT_MATERIALS[] = { packMaterial(TEXTURE_FUR), packMaterial(TEXTURE_FUR, TEXTURE_FUR) };
 
     // Use to determine if color should be used
-    color noColor;
+    constexpr color noColor = { 1.0f, 1.0f, 1.0f, 1.0f };
 
     // Base color of the cat
-    color catColor;
+    constexpr color catColor = { 1.0f, 1.0f, 1.0f, 1.0f };
 
     // Sets the color of the glass
-    color glassColor;
-
-    // Textures
-    unsigned int texture1;
-    unsigned int texture2;
-    unsigned int texture3;
-    unsigned int texture4;
-    unsigned int texture5;
-    unsigned int texture6;
-    unsigned int texture7;
-    unsigned int texture8;
+    constexpr color glassColor = { 0.951f, 0.9298f, 0.812f, 1.0f };
+
+    // Generator behind a procedural mesh, the values are shared with shader.vs
+    enum ProceduralShape
+    {
+        SHAPE_NONE,             // hand-written mesh, no levels of detail
+        SHAPE_CYLINDER_SIDE,
+        SHAPE_CYLINDER_TOP,
+        SHAPE_CYLINDER_BOTTOM,
+        SHAPE_SPHERE,
+        SHAPE_CONE
+    };
+
+    // What a mesh is generated from; radius is also the bounding circle used to pick its level
+    struct ProceduralMesh
+    {
+        ProceduralShape shape;
+        float height;
+        float radius;
+        color meshColor;
+    };
+
+    // Names for the microbenchmark tables, in MeshId order
+    const char* const MESH_NAMES[MESH_COUNT] = { "cyl1 side", "cyl1 top", "cyl1 bottom", "cyl2 side", "cyl2 top",
+        "cyl2 bottom", "pyramid", "plane", "sphere", "cyl3 side", "cone", "cube", "card", "cyl4 side" };
+
+    // Generator arguments of every mesh, in MeshId order
+    constexpr ProceduralMesh PROCEDURAL_MESHES[MESH_COUNT] = {
+        { SHAPE_CYLINDER_SIDE, 0.35f, 0.2375f, glassColor },    // MESH_CYL1_SIDE
+        { SHAPE_CYLINDER_TOP, 0.35f, 0.2375f, glassColor },     // MESH_CYL1_TOP
+        { SHAPE_CYLINDER_BOTTOM, 0.35f, 0.2375f, glassColor },  // MESH_CYL1_BOTTOM
+        { SHAPE_CYLINDER_SIDE, 0.03125f, 0.57f, noColor },      // MESH_CYL2_SIDE
+        { SHAPE_CYLINDER_TOP, 0.03125f, 0.57f, noColor },       // MESH_CYL2_TOP
+        { SHAPE_CYLINDER_BOTTOM, 0.03125f, 0.57f, noColor },    // MESH_CYL2_BOTTOM
+        { SHAPE_NONE },                                         // MESH_PYRAMID
+        { SHAPE_NONE },                                         // MESH_PLANE
+        { SHAPE_SPHERE, 0.0f, 0.5625f, catColor },              // MESH_SPHERE
+        { SHAPE_CYLINDER_SIDE, 1.4375f, 0.5625f, catColor },    // MESH_CYL3_SIDE
+        { SHAPE_CONE, 0.5f, 0.25f, catColor },                  // MESH_CONE
+        { SHAPE_NONE },                                         // MESH_CUBE
+        { SHAPE_NONE },                                         // MESH_CARD
+        { SHAPE_CYLINDER_SIDE, 1.1f, 0.1f, catColor },          // MESH_CYL4_SIDE
+    };
+
+    // Box and sphere around every mesh, every level of a procedural mesh fits in the same ones
+    MeshBounds meshBounds[MESH_COUNT];
+
+    // Images of the textures, one layer each, and the samplers that give each texture its wrap mode
+    TextureArray materialArray;
+    TextureSamplers textureSamplers;
+    // Images by content, and the layer of every texture's image (-1 when its file is missing)
+    TextureCache textureCache;
+    std::vector<TextureImage> textureImages;
+    int textureLayers[TEXTURE_COUNT];
+
+    // Textures are streamed into the array over the first frames instead of being uploaded before
+    // the render loop starts, layers show a placeholder until they arrive (turned off with
+    // --no-texture-streaming)
+    bool textureStreaming = true;
+    // Texel bytes uploaded per frame while streaming (set with --texture-budget, in KiB)
+    size_t textureBudgetBytes = size_t(4) << 20;
+    TextureStreamer textureStreamer;
+    // Decodes finished on the workers. Declared before the pool, so it outlives tasks still
+    // running when the program exits.
+    CompletionQueue<DecodedTexture> decodedTextures;
+    // Uploads the .dds files written by --compress-textures instead of decoding the images, when every
+    // image has one that is up to date (turned off with --no-compressed-textures)
+    bool compressedTextures = true;
+    // Writes those files and exits (--compress-textures)
+    bool compressTexturesMode = false;
+    // How the mip levels are filtered on the workers (set with --mip-filter), and whether in linear
+    // light rather than on the sRGB encoded values (--mip-gamma)
+    MipFilter mipFilter = MIP_FILTER_BOX;
+    bool mipGamma = false;
+    // Images not yet taken from the decodes, and the next one to decode when there are no workers
+    size_t texturesDecoding = 0;
+    size_t nextTextureImage = 0;
+    // Bit per layer holding its image, shader.fs shows a placeholder for the others
+    unsigned int residentLayers = 0;
+    bool texturesFinished = false;
 
     // Mesh data
-    GLMesh mesh;
+    MeshRegistry meshes;
 
     // Main window
     GLFWwindow* window = nullptr;
+
+    // Headless benchmark settings (set with --bench)
+    bool benchMode = false;
+    int benchFrames = 500;
+    std::string benchOutput = "bench_results.json";
+    std::string benchCapture;
+    // Runs the CPU-only geometry microbenchmark instead of the scene (--microbench)
+    bool microbenchMode = false;
+
+    // Vertex layout for the mesh registry (set with --vertex-format)
+    VertexFormat vertexFormat = VERTEX_FORMAT_FLOAT;
+    // Reorders triangles for the post-transform vertex cache before upload (off with --no-vertex-cache-order)
+    bool vertexCacheOrder = true;
+    // Merges duplicate vertices inside each mesh before upload (off with --no-vertex-weld)
+    bool vertexWeld = true;
+
+    // Binary mesh cache, written on the first run and mapped on later ones (set with --mesh-cache, off with --no-mesh-cache)
+    std::string meshCachePath = "mesh_cache.bin";
+    // Where this run's meshes came from and how long creating them took, reported by --bench
+    std::string meshSource;
+    double meshSetupMs = 0.0;
+    // Time the CPU side of the mesh build took on its worker, and from main() to the first frame
+    double meshBuildMs = 0.0;
+    double startupMs = 0.0;
+    // Time from createTextures until every texture is uploaded, reported by --bench
+    double textureSetupMs = 0.0;
+    std::chrono::steady_clock::time_point textureStart;
+
+    // Worker threads for the CPU side of startup, -1 uses one per hardware thread and 0 keeps
+    // everything on the main thread (set with --worker-threads)
+    int workerThreads = -1;
+    std::unique_ptr<ThreadPool> workers;
+    // Mesh build started before the context exists, true when the cache file already holds the meshes
+    std::future<bool> meshBuild;
+    // Cache key of the meshes being built
+    std::uint64_t meshKey = 0;
+
+    // Spreads per-mesh work over the workers, or runs it in order without them
+    struct WorkerForEach
+    {
+        template <typename Body>
+        void operator()(size_t count, Body body) const
+        {
+            if (workers)
+                workers->parallelFor(count, body);
+            else
+                SerialForEach()(count, body);
+        }
+    };
+
+    // Counters for the frame currently being drawn
+    FrameCounters frameCounters;
+
+    // Where the OpenGL context comes from (set with --backend)
+    enum ContextBackend
+    {
+        BACKEND_GLFW,   // visible (or hidden, for --bench) GLFW window
+        BACKEND_EGL     // surfaceless EGL context, no window system needed
+    };
+    ContextBackend contextBackend = BACKEND_GLFW;
+
+#ifdef SCENE_HAS_EGL
+    // Context used by the EGL backend
+    HeadlessContext headlessContext;
+#endif
 }
 
 // Function to adjust window size
@@ -122,33 +444,155 @@ std::vector<float> genCylBottomVerts(int sides, float height, float radius, colo
 // Funciton to generate cylinder bottom indices
 std::vector<unsigned int> genCylBottomIndices(int sides);
 // Function to generate sphere vertices
-std::vector<float> genSphereVerts(float radius, color color);
+std::vector<float> genSphereVerts(int rings, int segments, float radius, color color);
 // Function to generate sphere indices
-std::vector<unsigned int> genSphereIndices();
+std::vector<unsigned int> genSphereIndices(int rings, int segments);
 // Function to generate a pyramids vertices
 std::vector<float> genPyramidVerts(int sides, float height, float radius, color color);
-// Function to generate a pyramids indices
-std::vector<unsigned int> genPyramidIndices(int sides);
+// Function to generate indices for a triangle soup
+std::vector<unsigned int> genSequentialIndices(unsigned int vertexCount);
 // Function to create textures
 void createTextures();
+// Function to decode, resample and build the mip chain of one image, safe to run on a worker
+DecodedTexture decodeTexture(int layer, TextureImage& image);
+// Function to take the next finished decode
+bool takeDecodedTexture(DecodedTexture& texture, bool wait);
+// Function to upload a decoded texture into its layer, or queue it for streaming
+void uploadTexture(DecodedTexture& texture);
+// Function to stream this frame's share of the textures
+void streamTextures(Shader& ourShader);
+// Function to record that every texture is in
+void finishTextures();
+// Function to hash the contents and decode settings of an image
+std::uint64_t textureImageKey(const TextureSource& source, const std::vector<unsigned char>& file);
+// Function to upload the compressed versions of the images
+bool loadCompressedTextures();
+// Function to write the compressed version of every image
+bool compressTextures();
 
 // Function for toggling view between orthographic and perspective 
 void toggleView();
 // Function to initialize program
 bool progInitialize(GLFWwindow** window);
+// Function to create the surfaceless EGL context
+bool progInitializeEGL();
+// Function to release the window or context
+void progTerminate();
+// Function to start building the meshes on the workers
+void startMeshBuild();
+// Function to build the meshes on the CPU
+bool buildMeshes(MeshRegistry& meshes);
 // Function to create the mesh
-void createMesh(GLMesh& mesh);
+void createMesh(MeshRegistry& meshes);
+// Function to add the compile-time meshes to the registry
+void addStaticMeshes(MeshRegistry& meshes);
+// Function to generate the meshes at the current resolutions and add them to the registry
+void addGeneratedMeshes(MeshRegistry& meshes);
+// Function to add a hand-written mesh to the registry
+void addAuthoredMesh(MeshRegistry& meshes, MeshId mesh);
+// Function to add only the hand-written meshes, for vertex pulling
+void addPulledMeshes(MeshRegistry& meshes);
+// Function to generate the vertices of one level of a procedural mesh
+std::vector<float> genLodVerts(MeshId mesh, int sides);
+// Function to generate the indices of one level of a procedural mesh
+std::vector<unsigned int> genLodIndices(MeshId mesh, int sides);
+// Function to hash everything the meshes are generated from
+std::uint64_t meshCacheKey();
+// Function to draw the scene
+void renderScene(Shader& ourShader);
+// Function to queue a mesh at the level of detail its screen size needs
+void queueMesh(Shader& ourShader, MeshId mesh, const glm::mat4& model, unsigned int material);
+// Function to queue copies of a mesh as one instanced draw per level of detail
+void queueInstances(Shader& ourShader, MeshId mesh, std::vector<MeshInstance>& instances);
+// Function to draw the queued items in state order
+void submitDrawList(Shader& ourShader);
+// Function to measure how far along the view an object is
+float viewDepth(const glm::mat4& model);
+// Function to set up a pulled mesh at a number of sides and return its vertex count
+int bindPulledMesh(Shader& ourShader, MeshId mesh, int sides);
+// Function to scatter the extra props over the plane
+void placeProps(int count);
+// Function to compute the bounding volumes of every mesh
+void computeMeshBounds();
+// Function to add an object to the frame's culling batch
+void addSceneObject(std::initializer_list<MeshId> meshes, const glm::mat4& model, unsigned int material);
+// Function to cull the frame's objects in one batch and queue the visible ones
+void queueSceneObjects(Shader& ourShader);
+// Function to drop the copies of a mesh that are outside the view frustum
+void cullInstances(MeshId mesh, std::vector<MeshInstance>& instances);
+// Function to measure the radius of a procedural mesh on screen
+float projectedRadius(MeshId mesh, const glm::mat4& model);
+// Function to pick the level of detail of a procedural mesh
+int selectLod(MeshId mesh, const glm::mat4& model);
+// Function to pick the number of sides of a pulled procedural mesh
+int selectPulledSides(MeshId mesh, const glm::mat4& model);
+// Function to find a level of a mesh in the registry
+int registryMesh(MeshId mesh, int level);
+// Function to count the entries of the registry
+int registryMeshCount();
+
+// Function to read the command line options
+bool parseArguments(int argc, char* argv[]);
+// Function to render the benchmark frames offscreen
+bool runBenchmark(Shader& ourShader);
+// Function to place the camera for a benchmark frame
+void setBenchCamera(int frame, int frameCount);
+// Function to time the mesh generators without a GL context
+bool runGeometryMicrobench();
+// Function to compare the vector vertex kernels against their scalar versions
+bool checkMeshKernels();
+// Function to report the vertex cache use of every mesh before and after reordering
+bool checkVertexCacheOrder();
+// Function to report how many vertices welding removes from every mesh
+bool checkVertexWelding();
+// Function to compare the runtime generators against the compile-time meshes
+bool checkStaticMeshes();
+// Function to compare two vertex buffers within the kernel tolerance
+bool compareMeshVertices(const char* name, const float* expected, const float* actual, size_t floatCount, float radius, float& worstError);
 
 // Function to generate a r/g/b value
 float genColorValue();
 
 
-int main()
+int main(int argc, char* argv[])
 {
+    if (!parseArguments(argc, argv))
+        return EXIT_FAILURE;
+
+    auto startupStart = std::chrono::steady_clock::now();
+
+    placeProps(propCount);
+    computeMeshBounds();
+
+    // Worker threads for the CPU side of startup
+    if (workerThreads != 0)
+        workers.reset(new ThreadPool(workerThreads < 0 ? 0 : static_cast<unsigned int>(workerThreads)));
+
+    if (microbenchMode)
+    {
+        return runGeometryMicrobench() ? 0 : EXIT_FAILURE;
+    }
+    if (compressTexturesMode)
+    {
+        return compressTextures() ? 0 : EXIT_FAILURE;
+    }
+
+    // Meshes are built on the workers while the window, textures and shader are set up
+    startMeshBuild();
+
     if (!progInitialize(&window))
+    {
+        if (meshBuild.valid())
+            meshBuild.wait();
         return EXIT_FAILURE;
+    }
 
-    createMesh(mesh);
+    // multi-draw indirect is core from 4.3, older contexts keep one draw call per item
+    if (multiDrawIndirect && !GLAD_GL_VERSION_4_3)
+    {
+        std::cout << "OpenGL 4.3 is not available, drawing without multi-draw indirect" << std::endl;
+        multiDrawIndirect = false;
+    }
 
     createTextures();
 
@@ -160,17 +604,43 @@ int main()
     Shader ourShader("shader.vs", "shader.fs");
 
     ourShader.use();
-    ourShader.setInt("texture1", 0);
-    ourShader.setInt("texture2", 1);
-    ourShader.setInt("texture3", 2);
-    ourShader.setInt("texture4", 3);
-    ourShader.setInt("texture5", 4);
-    ourShader.setInt("texture6", 5);
-    ourShader.setInt("texture7", 6);
-    ourShader.setInt("texture8", 7);
+    drawUniforms = { ourShader.location("shape"), ourShader.location("sides"), ourShader.location("height"),
+        ourShader.location("radius"), ourShader.location("shapeColor") };
+    ourShader.setInt("materialsRepeat", WRAP_REPEAT);
+    ourShader.setInt("materialsMirroredRepeat", WRAP_MIRRORED_REPEAT);
+    ourShader.setInt("materialsClampToEdge", WRAP_CLAMP_TO_EDGE);
+    for (const TextureSource& source : TEXTURE_SOURCES)
+    {
+        std::string index = "[" + std::to_string(source.texture) + "]";
+        ourShader.setInt(("textureLayer" + index).c_str(), textureLayers[source.texture]);
+        ourShader.setInt(("textureWrap" + index).c_str(), source.wrap);
+    }
+    ourShader.setUInt("residentLayers", residentLayers);
+
+    // Only waiting for the workers and the upload are left on the main thread
+    auto meshStart = std::chrono::steady_clock::now();
+    createMesh(meshes);
+    meshSetupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+    startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
 
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    // headless benchmark replaces the interactive loop
+    if (benchMode)
+    {
+        bool written = runBenchmark(ourShader);
+        meshes.release();
+        glDeleteVertexArrays(1, &pullingVAO);
+        instanceBuffer.release();
+        frameUniforms.release();
+        indirectBuffer.release();
+        materialArray.release();
+        textureSamplers.release();
+        textureStreamer.release();
+        progTerminate();
+        return written ? 0 : EXIT_FAILURE;
+    }
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -184,644 +654,512 @@ int main()
         // input
         processInput(window);
 
-        // Clears frame and sets background color
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        
-        // Activate Shader
-        ourShader.use();
+        renderScene(ourShader);
 
-        // Check for OpenGL errors
-        GLenum error = glGetError();
-        if (error != GL_NO_ERROR)
-        {
-            // Print or log the error code for debugging
-            std::cout << "OpenGL error: " << error << std::endl;
-        }
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
 
-        // Light properties
-        glm::vec3 lightPos(1.2f, 1.0f, 2.0f); // Position of the light source
-        glm::vec3 lightColor(1.0f, 1.0f, 1.0f); // Color of the light source
-        ourShader.setLightPosition("lightPos", lightPos);
-        ourShader.setLightColor("lightColor", lightColor);
-
-        // initialize model for transformations
-        glm::mat4 model = glm::mat4(1.0f);
-       
-        // Transforms the first object (Lower Cylinder)
-        // Move to the left
-        glm::mat4 translation = glm::translate(glm::vec3(-1.5f, -0.625, 0.0f)); // -0.625 places it ontop of the plane
-        // Rotations
-        glm::mat4 rotation = glm::rotate(glm::radians(30.0f), glm::vec3(0.f, 1.0f, 0.0f));
-        // Sets the model
-        model = translation * rotation;
-        ourShader.setMat4("model", model);
-
-        // Sets the projection (view type)
-        ourShader.setMat4("projection", projection); // Changes when P is pressed
-
-        // camera/view transformation
-        glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("view", view);
-
-        // Bind textures For the first cylinder
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture8);
-        //glActiveTexture(GL_TEXTURE1);
-        //glBindTexture(GL_TEXTURE_2D, texture8);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 1);
-
-        // First cylinder sides
-        glBindVertexArray(mesh.VAOs[0]);
-        // Draw the sides of the first cylinder
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[0], GL_UNSIGNED_INT, 0);
-
-        // First cylinder top
-        glBindVertexArray(mesh.VAOs[1]);
-        // Draw the top of the first cylinder
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[1], GL_UNSIGNED_INT, 0);
-
-        // First cylinder bottom
-        glBindVertexArray(mesh.VAOs[2]);
-        // Draw the bottom of the first cylinder
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[2], GL_UNSIGNED_INT, 0);
-
-        // Unbind second texture
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Transforms the second object (Upper Cylinder)
-        // Move to the left and up (to sit ontop of the other cylinder)
-        translation = glm::translate(glm::vec3(-1.5f, 0.35, 0.0f)); // -0.23 places it ontop of the other cylinder
-        // Sets the model
-        glm::mat4 scalecylinder = glm::scale(glm::vec3(0.0f, 2.0f, 0.0f));
-        model = translation * scalecylinder;
-
-        ourShader.setMat4("model", model);
-
-        // Second cylinder
-        glBindVertexArray(mesh.VAOs[3]);
-
-        // Bind texture for upper cylinder
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture6);
-        // Transforms the third object (Pyramid)
-
-
-        // Draw the second cylinder sides
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[3], GL_UNSIGNED_INT, 0);
-
-        // second cylinder top
-        glBindVertexArray(mesh.VAOs[4]);
-        // Draw the top of the first cylinder
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[4], GL_UNSIGNED_INT, 0);
-
-        // second cylinder bottom
-        glBindVertexArray(mesh.VAOs[5]);
-        // Draw the bottom of the first cylinder
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[5], GL_UNSIGNED_INT, 0);
-
-
-        // Bind textures for Pyramid
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture7);
-        //Transforms the third object (Pyramid)
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 2);
-        // Move to the right
-        translation = glm::translate(glm::vec3(-1.5f, -0.40, 0.0f)); // -0.765625 places it ontop of the plane
-        // Rotate the object slightly
-        rotation = glm::rotate(glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        // Sets the model
-        model = translation * rotation;
-
-        ourShader.setMat4("model", model);
-
-        // Third Object (Cube)
-        glBindVertexArray(mesh.VAOs[6]);
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-
-        // Bind textures for Plane
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture5);
-
-        // Transforms the fourth object (plane)
-        // Scales the object
-        glm::mat4 scale = glm::scale(glm::vec3(10.0f, 0.0f, 10.0f));
-        // Move down
-        translation = glm::translate(glm::vec3(0.0f, -1.0f, 0.0f)); 
-        // Sets the model
-        model = translation * scale;
+    // optional: de-allocate all resources once they've outlived their purpose:
+    // ------------------------------------------------------------------------
+    meshes.release();
+    glDeleteVertexArrays(1, &pullingVAO);
+    instanceBuffer.release();
+    frameUniforms.release();
+    indirectBuffer.release();
+    materialArray.release();
+    textureSamplers.release();
+    textureStreamer.release();
 
-        ourShader.setMat4("model", model);
+    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // ------------------------------------------------------------------
+    progTerminate();
+    return 0;
+}
 
-        // Fourth Object (Plane)
-        glBindVertexArray(mesh.VAOs[7]);
+// Draws every object in the scene with the given shader
+void renderScene(Shader& ourShader)
+{
+    frameCounters = FrameCounters();
 
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[7], GL_UNSIGNED_INT, 0);
+    // Clears frame and sets background color
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        
-        float xScale = 0.625 / 0.5625;
-        float zScale = 0.125 / 0.5625;
-
-        // Bind textures sphere 1
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-
-        // Transforms the fifth object (sphere 1)
-        // Scales the object
-        scale = glm::scale(glm::vec3(0.25f, 0.25f, 0.25f));
-        // Rotation
-        rotation = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.7f, 0.0f));
-        glm::mat4 rotation2 = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        // Moves the object
-        translation = glm::translate(glm::vec3(-0.7f, -0.7f, -1.1f));
-        // Sets the model
-        model = translation * rotation2 * rotation * scale;
-
-        ourShader.setMat4("model", model);
-
-        // Fifth Object (Sphere 1)
-        glBindVertexArray(mesh.VAOs[8]);
-
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[8], GL_UNSIGNED_INT, 0);
-
-        // Bind textures for sphere 2
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        //glBindTexture(GL_TEXTURE_2D, texture6); // Face Texture (Not correct currently)
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 1); // Change to 2  for face
-
-        zScale = 0.1875 / 0.5625;
-
-        // Transforms the fifth object (Face) (gives sphere 2)
-        // Scales the object
-        scale = glm::scale(glm::vec3(0.25f, 0.25f, 0.25f));
-        // Rotation
-        rotation = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.7f, 0.0f));
-        rotation2 = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        // Moves object
-        translation = glm::translate(glm::vec3(-0.219049f, -0.7f, -0.140525f));
-        // Sets the model
-        model = translation * rotation2 * rotation * scale;
-
-        ourShader.setMat4("model", model);
-
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[8], GL_UNSIGNED_INT, 0);
-        
-        // card
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture3);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 1);
-
-        // Transforms the sixth object (card)
-        // Scales the object
-        scale = glm::scale(glm::vec3(xScale, 1.0f, 1.0f));
-        // Rotates the object
-        rotation = glm::rotate(glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        rotation2 = glm::rotate(glm::radians(0.0f), glm::vec3(0.0f, 0.7f, 0.0f));
-        glm::mat4 rotation3 = glm::rotate(glm::radians(0.0f), glm::vec3(-0.5f, -0.5f, 1.0f));
-        // Moves object
-        translation = glm::translate(glm::vec3(0.0f, -1.45f, 2.0f)); 
-        // Sets the model
-        model = translation * rotation * scale; // * rotation3 * rotation2
+    
+    // Activate Shader
+    ourShader.use();
 
-        
+    // Check for OpenGL errors
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        // Print or log the error code for debugging
+        std::cout << "OpenGL error: " << error << std::endl;
+    }
 
-        ourShader.setMat4("model", model);
+    // Upload this frame's share of the textures still streaming in
+    streamTextures(ourShader);
+
+    // Light properties
+    glm::vec3 lightPos(1.2f, 1.0f, 2.0f); // Position of the light source
+    glm::vec3 lightColor(1.0f, 1.0f, 1.0f); // Color of the light source
+
+    // camera/view transformation
+    glm::mat4 view = camera.GetViewMatrix();
+
+    // One upload for the frame, the projection changes when P is pressed
+    frameUniforms.update(view, projection, lightPos, lightColor);
+
+    culler.setFrustum(projection * view);
+
+    // Objects are only queued here, submitDrawList sorts them by state and draws them at the end
+    drawList.clear();
+    frameInstances.clear();
+    sceneObjects.clear();
+
+    // Material of every object, the textures it samples
+    constexpr unsigned int glassMaterial = packMaterial(TEXTURE_LID);
+    constexpr unsigned int woodMaterial = packMaterial(TEXTURE_TIEDYE);
+    constexpr unsigned int pyramidMaterial = packMaterial(TEXTURE_LABEL, TEXTURE_FUR);
+    constexpr unsigned int planeMaterial = packMaterial(TEXTURE_WOOD_MIRRORED, TEXTURE_FUR);
+    constexpr unsigned int cardMaterial = packMaterial(TEXTURE_CARD);
+    constexpr unsigned int furMaterial = packMaterial(TEXTURE_FUR);
+
+    // initialize model for transformations
+    glm::mat4 model = glm::mat4(1.0f);
+   
+    // Transforms the first object (Lower Cylinder)
+    // Move to the left
+    glm::mat4 translation = glm::translate(glm::vec3(-1.5f, -0.625, 0.0f)); // -0.625 places it ontop of the plane
+    // Rotations
+    glm::mat4 rotation = glm::rotate(glm::radians(30.0f), glm::vec3(0.f, 1.0f, 0.0f));
+    // Sets the model
+    model = translation * rotation;
+
+    // First cylinder sides, top and bottom
+    addSceneObject({ MESH_CYL1_SIDE, MESH_CYL1_TOP, MESH_CYL1_BOTTOM }, model, glassMaterial);
+
+    // Transforms the second object (Upper Cylinder)
+    // Move to the left and up (to sit ontop of the other cylinder)
+    translation = glm::translate(glm::vec3(-1.5f, 0.35, 0.0f)); // -0.23 places it ontop of the other cylinder
+    // Sets the model
+    glm::mat4 scalecylinder = glm::scale(glm::vec3(0.0f, 2.0f, 0.0f));
+    model = translation * scalecylinder;
+
+    // Second cylinder sides, top and bottom
+    addSceneObject({ MESH_CYL2_SIDE, MESH_CYL2_TOP, MESH_CYL2_BOTTOM }, model, woodMaterial);
+
+    //Transforms the third object (Pyramid)
+    // Move to the right
+    translation = glm::translate(glm::vec3(-1.5f, -0.40, 0.0f)); // -0.765625 places it ontop of the plane
+    // Rotate the object slightly
+    rotation = glm::rotate(glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    // Sets the model
+    model = translation * rotation;
+
+    // Third Object (Pyramid)
+    addSceneObject({ MESH_PYRAMID }, model, pyramidMaterial);
+
+    // Transforms the fourth object (plane)
+    // Scales the object
+    glm::mat4 scale = glm::scale(glm::vec3(10.0f, 0.0f, 10.0f));
+    // Move down
+    translation = glm::translate(glm::vec3(0.0f, -1.0f, 0.0f)); 
+    // Sets the model
+    model = translation * scale;
+
+    // Fourth Object (Plane), blended with the cat texture
+    addSceneObject({ MESH_PLANE }, model, planeMaterial);
 
-        //card
-        glBindVertexArray(mesh.VAOs[12]);
+    
+    float xScale = 0.625 / 0.5625;
+
+    // Transforms the fifth object (sphere 1)
+    // Scales the object
+    scale = glm::scale(glm::vec3(0.25f, 0.25f, 0.25f));
+    // Rotation
+    rotation = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.7f, 0.0f));
+    glm::mat4 rotation2 = glm::rotate(glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    // Moves the object
+    translation = glm::translate(glm::vec3(-0.7f, -0.7f, -1.1f));
+    // Sets the model
+    catInstances.clear();
+    catInstances.push_back({ translation * rotation2 * rotation * scale, CAT_MATERIALS[1] });
+
+    // Transforms the fifth object (Face) (gives sphere 2)
+    // Moves object
+    translation = glm::translate(glm::vec3(-0.219049f, -0.7f, -0.140525f));
+    // Sets the model
+    catInstances.push_back({ translation * rotation2 * rotation * scale, CAT_MATERIALS[0] }); // Change to packMaterial(TEXTURE_FUR, TEXTURE_TIEDYE) for face (not correct currently)
+
+    // Fifth Object (Sphere 1 and 2), plus the extra props; the copies outside the view are dropped
+    catInstances.insert(catInstances.end(), props.begin(), props.end());
+    cullInstances(MESH_SPHERE, catInstances);
+    queueInstances(ourShader, MESH_SPHERE, catInstances);
+    
+    // Transforms the sixth object (card)
+    // Scales the object
+    scale = glm::scale(glm::vec3(xScale, 1.0f, 1.0f));
+    // Rotates the object
+    rotation = glm::rotate(glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    rotation2 = glm::rotate(glm::radians(0.0f), glm::vec3(0.0f, 0.7f, 0.0f));
+    // Moves object
+    translation = glm::translate(glm::vec3(0.0f, -1.45f, 2.0f)); 
+    // Sets the model
+    model = translation * rotation * scale; // * rotation2
+
+    //card
+    addSceneObject({ MESH_CARD }, model, cardMaterial);
+    
+    /*/
+    // Transforms the seventh object (cone 1)
+    // Moves object
+    translation = glm::translate(glm::vec3(-0.02f, 0.5f, -0.58f));
+    // Rotation
+    rotation2 = glm::rotate(glm::radians(-25.0f), glm::vec3(0.7f, 0.0f, 0.0f));
+    // Sets the model
+    model = translation * rotation2;
+
+    // seventh Object (cone)
+    queueMesh(ourShader, MESH_CONE, model, furMaterial);
+
+    // Transforms the seventh object (gives cone 2)
+    // Moves object
+    translation = glm::translate(glm::vec3(-0.55f, 0.53f, -0.30f));
+    // Rotations
+    rotation = glm::rotate(glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 0.1f));
+    rotation2 = glm::rotate(glm::radians(-15.0f), glm::vec3(0.7f, 0.0f, 0.0f));
+    // Sets the model
+    model = translation * rotation2 * rotation;
+
+    // seventh Object (cone)
+    queueMesh(ourShader, MESH_CONE, model, furMaterial);
+    */
+
+    // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+    // -------------------------------------------------------------------------------
+    
+    // Transforms the third object (Cube)
+    // Move to the right
+    translation = glm::translate(glm::vec3(1.5f, -0.40, 1.0f)); // -0.765625 places it ontop of the plane
+    // Rotate the object slightly
+    rotation = glm::rotate(glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    // Sets the model
+    model = translation * rotation;
 
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[12], GL_UNSIGNED_INT, 0);
-        
-        /*/
-        // Transforms the seventh object (cone 1)
-        // Moves object
-        translation = glm::translate(glm::vec3(-0.02f, 0.5f, -0.58f));
-        // Rotation
-        rotation2 = glm::rotate(glm::radians(-25.0f), glm::vec3(0.7f, 0.0f, 0.0f));
-        // Sets the model
-        model = translation * rotation2;
+    // Third Object (Cube), the cat texture blended with itself like sphere 1
+    addSceneObject({ MESH_CUBE }, model, CAT_MATERIALS[1]);
 
-        ourShader.setMat4("model", model);
+    
+    //Transforms the third object (cotton cylinder)
+    // Move to the right
+    translation = glm::translate(glm::vec3(-0.45f, -0.7f, -0.6f)); // -0.765625 places it ontop of the plane
+    // Rotate the object slightly
+    rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -0.5f));
+    // Sets the model
+    model = translation * rotation;
 
-        // seventh Object (cone)
-        glBindVertexArray(mesh.VAOs[10]);
+    // middle cotton
+    addSceneObject({ MESH_CYL4_SIDE }, model, furMaterial);
 
-        glDrawArrays(GL_TRIANGLES, 0, mesh.indexCounts[10] / 9);
+    // Every object above against the frustum at once
+    queueSceneObjects(ourShader);
 
-        // Transforms the seventh object (gives cone 2)
-        // Moves object
-        translation = glm::translate(glm::vec3(-0.55f, 0.53f, -0.30f));
-        // Rotations
-        rotation = glm::rotate(glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 0.1f));
-        rotation2 = glm::rotate(glm::radians(-15.0f), glm::vec3(0.7f, 0.0f, 0.0f));
-        // Sets the model
-        model = translation * rotation2 * rotation;
+    submitDrawList(ourShader);
+}
 
-        ourShader.setMat4("model", model);
+// Function to create textures
+// Every file is read and hashed first, so textures with the same contents share one image. Images
+// compressed ahead of time are uploaded as they are. Otherwise they are decoded and resampled on the
+// workers; without streaming this thread uploads each one as soon as it is ready, with streaming it
+// only sets up the ring and the render loop takes over.
+void createTextures() {
 
-        // seventh Object (cone)
-        glBindVertexArray(mesh.VAOs[10]);
+    textureStart = std::chrono::steady_clock::now();
+    for (const TextureSource& source : TEXTURE_SOURCES)
+    {
+        std::vector<unsigned char> file;
+        if (!readFileBytes(source.path, file))
+        {
+            // missing files keep the placeholder
+            textureLayers[source.texture] = -1;
+            continue;
+        }
 
-        glDrawArrays(GL_TRIANGLES, 0, mesh.indexCounts[10] / 9);
-        */
+        bool added;
+        std::uint64_t key = textureImageKey(source, file);
+        textureLayers[source.texture] = textureCache.acquire(key, added);
+        if (added)
+            textureImages.push_back({ source.path, source.flip, key, std::move(file) });
+    }
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        
-        // Bind textures for Cube
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        //Transforms the third object (Cube)
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 2);
-        // Move to the right
-        translation = glm::translate(glm::vec3(1.5f, -0.40, 1.0f)); // -0.765625 places it ontop of the plane
-        // Rotate the object slightly
-        rotation = glm::rotate(glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        // Sets the model
-        model = translation * rotation;
-
-        ourShader.setMat4("model", model);
-
-        // Third Object (Cube)
-        glBindVertexArray(mesh.VAOs[11]);
-
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[11], GL_UNSIGNED_INT, 0);
+    if (compressedTextures && loadCompressedTextures())
+        return;
 
-        
-        // Bind textures for middle cotton
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        //Transforms the third object (cotton cylinder)
-        //glActiveTexture(GL_TEXTURE1);
-        //glBindTexture(GL_TEXTURE_2D, texture1);
-        glUniform1i(glGetUniformLocation(ourShader.ID, "numTextures"), 1);
-        // Move to the right
-        translation = glm::translate(glm::vec3(-0.45f, -0.7f, -0.6f)); // -0.765625 places it ontop of the plane
-        // Rotate the object slightly
-        rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -0.5f));
-        // Sets the model
-        model = translation * rotation;
-
-        ourShader.setMat4("model", model);
-
-        // Third Object (Cube)
-        glBindVertexArray(mesh.VAOs[13]);
-
-        glDrawElements(GL_TRIANGLES, mesh.indexCounts[13], GL_UNSIGNED_INT, 0);
-        
+    // every image is a layer of one array, resampled to its size, with every level down to 1x1
+    materialArray.create(MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE, std::max(textureCache.imageCount(), 1),
+        mipLevelCount(MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE));
+    textureSamplers.create();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    texturesDecoding = textureImages.size();
+    if (workers)
+    {
+        // the list does not change from here on, each task owns its own image
+        for (size_t image = 0; image < textureImages.size(); ++image)
+            workers->submit([image] { decodedTextures.push(decodeTexture(static_cast<int>(image), textureImages[image])); });
     }
 
-    // optional: de-allocate all resources once they've outlived their purpose:
-    // ------------------------------------------------------------------------
-    glDeleteVertexArrays(14, mesh.VAOs);
-    glDeleteBuffers(14, mesh.VBOs);
-    glDeleteBuffers(14, mesh.EBOs);
+    if (textureStreaming)
+    {
+        textureStreamer.create(materialArray, textureBudgetBytes);
+        return;
+    }
 
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
-    return 0;
+    DecodedTexture texture;
+    while (takeDecodedTexture(texture, true))
+        uploadTexture(texture);
+    finishTextures();
 }
 
-void createTextures() {
-    // load textures
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    // Find file
-    unsigned char* data = stbi_load(("resources/FurTexture.jpg"), &width, &height, &nrChannels, 0);
+// Function to decode, resample and build the mip chain of one image, safe to run on a worker
+// The flip is set for the calling thread only, so decodes with different settings can run at once.
+// Every level is filtered here, the GL thread only uploads them. The file bytes are freed once
+// decoded.
+DecodedTexture decodeTexture(int layer, TextureImage& image) {
+
+    DecodedTexture texture = { layer, 0, {} };
+    int width, height;
+    stbi_set_flip_vertically_on_load_thread(image.flip);
+    unsigned char* data = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height, &texture.channels, 0);
     if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture1);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
+        if (texture.channels == 3 || texture.channels == 4)
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
+            texture.levels.push_back(resampleToRGBA(data, width, height, texture.channels, MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE));
+            std::vector<std::vector<unsigned char>> chain = buildMipChain(texture.levels[0], MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE, mipFilter, mipGamma);
+            for (std::vector<unsigned char>& level : chain)
+                texture.levels.push_back(std::move(level));
         }
+        stbi_image_free(data);
+    }
+    std::vector<unsigned char>().swap(image.file);
+    return texture;
+}
 
+// Function to take the next finished decode
+// Waits for one when wait is set, false once every texture has been taken. Without workers the next
+// texture is decoded here instead.
+bool takeDecodedTexture(DecodedTexture& texture, bool wait) {
 
-        stbi_image_free(data);
+    if (texturesDecoding == 0)
+        return false;
+    if (!workers)
+    {
+        texture = decodeTexture(static_cast<int>(nextTextureImage), textureImages[nextTextureImage]);
+        ++nextTextureImage;
     }
-    // Find file
-    data = stbi_load(("resources/WoodTexture.jpg"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture2);
-        glBindTexture(GL_TEXTURE_2D, texture2);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
-        }
+    else if (wait)
+        texture = decodedTextures.pop();
+    else if (!decodedTextures.tryPop(texture))
+        return false;
+    --texturesDecoding;
+    return true;
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+// Function to upload a decoded texture into its layer, or queue it for streaming
+// Images that could not be decoded leave their layer with the placeholder.
+void uploadTexture(DecodedTexture& texture) {
 
-        stbi_image_free(data);
+    if (texture.channels == 0)
+        return;
+    if (texture.levels.empty())
+    {
+        std::cout << "Not implemented to handle image with " << texture.channels << " channels" << std::endl;
+        return;
+    }
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+    if (textureStreaming)
+    {
+        textureStreamer.queue(texture.layer, std::move(texture.levels));
+        return;
     }
-    // Find file
-    data = stbi_load(("resources/visa.jpg"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture3);
-        glBindTexture(GL_TEXTURE_2D, texture3);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
-        }
+    for (size_t level = 0; level < texture.levels.size(); ++level)
+        materialArray.setLevel(texture.layer, static_cast<int>(level), texture.levels[level].data());
+    residentLayers |= 1u << texture.layer;
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+// Function to stream this frame's share of the textures
+// Takes the decodes that finished (one decode per frame without workers), uploads up to the budget
+// and marks the completed layers resident.
+void streamTextures(Shader& ourShader) {
 
-        stbi_image_free(data);
+    if (!textureStreaming || texturesFinished)
+        return;
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+    DecodedTexture texture;
+    while (takeDecodedTexture(texture, false))
+    {
+        uploadTexture(texture);
+        if (!workers)
+            break;
     }
-    // Find file
-    data = stbi_load(("resources/Black Texture.jpg"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture4);
-        glBindTexture(GL_TEXTURE_2D, texture4);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
-        }
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+    std::vector<int> completed;
+    frameCounters.textureUploadBytes += static_cast<unsigned int>(textureStreamer.update(materialArray, completed));
+    for (int layer : completed)
+        residentLayers |= 1u << layer;
+    if (!completed.empty())
+        ourShader.setUInt("residentLayers", residentLayers);
 
-        stbi_image_free(data);
+    if (texturesDecoding == 0 && !textureStreamer.pending())
+        finishTextures();
+}
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-    }
-    // Find file
-    data = stbi_load(("resources/WoodTexture.jpg"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture5);
-        glBindTexture(GL_TEXTURE_2D, texture5);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
-        }
+// Function to record that every texture is in
+// Every mip level came with its image, so there is nothing left to generate on this thread.
+void finishTextures() {
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0); // Unbind the texture
+    // the read files are no longer needed
+    std::vector<TextureImage>().swap(textureImages);
+    textureSetupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - textureStart).count();
+    texturesFinished = true;
+}
 
-        stbi_image_free(data);
+// Function to hash the contents and decode settings of an image
+// Textures with the same key share an image, and a compressed file is only used for the key it was
+// written for, mip filter included.
+std::uint64_t textureImageKey(const TextureSource& source, const std::vector<unsigned char>& file) {
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-    }
-    // Find file
-    data = stbi_load(("resources/tiedye.jpg"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture6);
-        glBindTexture(GL_TEXTURE_2D, texture6);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
-        }
+    std::uint64_t key = hashBytes(&source.flip, sizeof(source.flip), hashBytes(file.data(), file.size()));
+    key = hashBytes(&mipFilter, sizeof(mipFilter), key);
+    return hashBytes(&mipGamma, sizeof(mipGamma), key);
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+// Function to upload the compressed versions of the images
+// All or nothing: every image needs a .dds file written for its current contents at the layer size,
+// otherwise nothing is uploaded and the images are decoded as usual. The files hold every mip level,
+// so the array is sampled with trilinear filtering and is complete as soon as this returns.
+bool loadCompressedTextures() {
 
-        stbi_image_free(data);
+    if (textureImages.empty())
+        return false;
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-    }
-    // Find file
-    data = stbi_load(("resources/label2.png"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture7);
-        glBindTexture(GL_TEXTURE_2D, texture7);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
+    std::vector<CompressedImage> images(textureImages.size());
+    for (size_t image = 0; image < textureImages.size(); ++image)
+    {
+        std::string path = compressedTexturePath(textureImages[image].path);
+        if (!readCompressedTexture(path, textureImages[image].key, MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE, images[image]))
         {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
+            // a file that is there but no longer matches is worth mentioning, a missing one is not
+            if (std::ifstream(path))
+                std::cout << path << " is out of date, decoding the images instead (rewrite it with --compress-textures)" << std::endl;
+            return false;
         }
+    }
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+    int levels = static_cast<int>(images[0].levels.size());
+    materialArray.createCompressed(MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE, static_cast<int>(images.size()), levels);
+    textureSamplers.create();
+    for (size_t image = 0; image < images.size(); ++image)
+    {
+        for (int level = 0; level < levels; ++level)
+            materialArray.setCompressedLevel(static_cast<int>(image), level, images[image].levels[level]);
+        residentLayers |= 1u << image;
+    }
+    finishTextures();
+    return true;
+}
 
-        stbi_image_free(data);
+// Function to write the compressed version of every image
+// Runs without a GL context (--compress-textures). Each distinct image is decoded, resampled and
+// filtered into its mip levels like at startup; every level is encoded to BC7 a band of block rows
+// per task on the workers. The .dds file is written next to the image and records the image's key, so
+// a changed image is decoded again until the files are rewritten.
+bool compressTextures() {
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-    }
-    // Find file
-    data = stbi_load(("resources/lid.png"), &width, &height, &nrChannels, 0);
-    if (data) {
-        stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-        glGenTextures(1, &texture8);
-        glBindTexture(GL_TEXTURE_2D, texture8);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Check channels
-        if (nrChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else if (nrChannels == 4)
+    const int bandRows = 16;
+    bool written = true;
+    for (const TextureSource& source : TEXTURE_SOURCES)
+    {
+        std::vector<unsigned char> file;
+        if (!readFileBytes(source.path, file))
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
+            // the scene shows the placeholder for it, there is nothing to compress
+            std::cout << "Skipping missing " << source.path << std::endl;
+            continue;
         }
-        else
+        bool added;
+        std::uint64_t key = textureImageKey(source, file);
+        textureCache.acquire(key, added);
+        if (!added)
+            continue;
+
+        auto start = std::chrono::steady_clock::now();
+        TextureImage image = { source.path, source.flip, key, std::move(file) };
+        DecodedTexture decoded = decodeTexture(0, image);
+        if (decoded.levels.empty())
         {
-            std::cout << "Not implemented to handle image with " << nrChannels << " channels" << std::endl;
+            std::cout << "Could not decode " << source.path << std::endl;
+            written = false;
+            continue;
         }
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+        CompressedImage compressed = { MATERIAL_TEXTURE_SIZE, MATERIAL_TEXTURE_SIZE, {} };
+        double squaredError = 0.0;
+        for (size_t l = 0; l < decoded.levels.size(); ++l)
+        {
+            int width = std::max(MATERIAL_TEXTURE_SIZE >> l, 1);
+            int height = std::max(MATERIAL_TEXTURE_SIZE >> l, 1);
+            compressed.levels.emplace_back(bc7LevelBytes(width, height));
+            int blockRows = (height + 3) / 4;
+            const unsigned char* rgba = decoded.levels[l].data();
+            unsigned char* blocks = compressed.levels.back().data();
+            WorkerForEach()((blockRows + bandRows - 1) / bandRows, [=](size_t band) {
+                int first = static_cast<int>(band) * bandRows;
+                encodeBC7Rows(rgba, width, height, first, std::min(bandRows, blockRows - first), blocks);
+            });
 
-        stbi_image_free(data);
+            // quality of the level everything close up samples
+            if (l == 0)
+            {
+                unsigned char texels[64];
+                for (size_t block = 0; block < compressed.levels[0].size() / BC7_BLOCK_BYTES; ++block)
+                {
+                    decodeBC7Block(blocks + block * BC7_BLOCK_BYTES, texels);
+                    int bx = static_cast<int>(block % (width / 4)) * 4, by = static_cast<int>(block / (width / 4)) * 4;
+                    for (int t = 0; t < 64; ++t)
+                    {
+                        double d = texels[t] - rgba[((static_cast<size_t>(by) + t / 16) * width + bx + (t / 4) % 4) * 4 + t % 4];
+                        squaredError += d * d;
+                    }
+                }
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+        std::string path = compressedTexturePath(source.path);
+        if (!writeCompressedTexture(path, compressed, key))
+        {
+            std::cout << "Could not write " << path << std::endl;
+            written = false;
+            continue;
+        }
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& blocks : compressed.levels)
+            bytes += blocks.size();
+        double mse = squaredError / (static_cast<double>(MATERIAL_TEXTURE_SIZE) * MATERIAL_TEXTURE_SIZE * 4);
+        std::cout << path << ": " << compressed.levels.size() << " levels, " << bytes << " bytes, PSNR "
+            << (mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0) << " dB, " << ms << " ms" << std::endl;
     }
+    return written;
 }
 
-// Function to create mesh
-void createMesh(GLMesh &mesh) {
-
-    noColor.redValue = 1.0f;
-    noColor.greenValue = 1.0f;
-    noColor.blueValue = 1.0f;
-    noColor.alphaValue = 1.0f;
-
-    glassColor.redValue = 0.951f;
-    glassColor.greenValue = 0.9298f;
-    glassColor.blueValue = 0.812f;
-    glassColor.alphaValue = 1.0f;
-
-    // All size values are 1/4 of real life sizes in inches
-
-    // Generates the first cylinder's side vetices and indices
-    std::vector<float> cylSideVertices1 = genCylSideVerts(sides, 0.35, 0.2375f, glassColor);
-    std::vector<unsigned int> cylSideIndices1 = genCylSideIndices(sides);
-    // Generates the first cylinder's top vetices and indices
-    std::vector<float> cylTopVertices1 = genCylTopVerts(sides, 0.35, 0.2375f, glassColor);
-    std::vector<unsigned int> cylTopIndices1 = genCylTopIndices(sides);
-    // Generates the first cylinder's bottom vetices and indices
-    std::vector<float> cylBottomVertices1 = genCylBottomVerts(sides, 0.35, 0.2375f, glassColor);
-    std::vector<unsigned int> cylBottomIndices1 = genCylBottomIndices(sides);
- 
-    // Generates the second cylinder's vetices and indices
-    std::vector<float> cylSideVertices2 = genCylSideVerts(sides, 0.03125f, 0.57f, noColor);
-    std::vector<unsigned int> cylSideIndices2 = genCylSideIndices(sides);
-    // Generates the second cylinder's top vetices and indices
-    std::vector<float> cylTopVertices2 = genCylTopVerts(sides, 0.03125f, 0.57f, noColor);
-    std::vector<unsigned int> cylTopIndices2 = genCylTopIndices(sides);
-    // Generates the second cylinder's bottom vetices and indices
-    std::vector<float> cylBottomVertices2 = genCylBottomVerts(sides, 0.03125f, 0.57f, noColor);
-    std::vector<unsigned int> cylBottomIndices2 = genCylBottomIndices(sides);
-
-    // Sets the length, width, and height of the pyramid
-    float length = 2.21875;
-    float width = 1.453125f;
-    float height = 0.46875;
-
+// Hand-written meshes and the compile-time generated ones, all in the binary's read-only data
+namespace
+{
     // Define the vertices of the pyramid and their associated colors
-    float PyramidVerts[] = {
+    const float PyramidVerts[] = {
         // Positions         // Color Coordinates    // Texture Coordinates
         -0.35f, -0.5f, -0.25f,  0.5f, 0.5f, 0.5f, 1.0f,  0.0f, 1.0f,  // Bottom left (red)
          0.35f, -0.5f, -0.25f,  0.5f, 0.5f, 0.5f, 1.0f,  0.5f, 1.0f,  // Bottom right (green)
@@ -852,7 +1190,7 @@ void createMesh(GLMesh &mesh) {
          0.0f,   0.4f,  0.0f,   0.5f, 0.5f, 0.5f, 1.0f,  0.0f, 0.0f,  // Top (red)
     };
 
-    float planeVerts[] = {
+    const float planeVerts[] = {
         // position             color                       texture
         -1.0f,  0.0f,  1.0f,    0.6f, 0.6f, 0.6f, 1.0f,     0.0f, 10.0f,       // Vertex 0
          1.0f,  0.0f,  1.0f,    0.6f, 0.6f, 0.6f, 1.0f,     10.0f, 10.0f,     // Vertex 1
@@ -860,13 +1198,13 @@ void createMesh(GLMesh &mesh) {
          1.0f,  0.0f, -1.0f,    0.6f, 0.6f, 0.6f, 1.0f,     10.0f, 0.0f        // Vertex 3
     };
 
-    unsigned int planeIndices[] = {
+    const unsigned int planeIndices[] = {
         0, 1, 2,
         1, 2, 3
     };
 
     // Vertices for a cube with colors and texture coordinates
-    float cubeVertices[] = {
+    const float cubeVertices[] = {
         // Positions          // Colors               // Texture Coordinates
         // Positions          // Color                  // Texture Coordinates
          0.5f,  0.55f, 0.5f,   1.0f, 0.0f, 0.0f, 1.0f,   1.0f, 1.0f, // Top Right Vertex 0
@@ -881,7 +1219,7 @@ void createMesh(GLMesh &mesh) {
     };
 
     // Indices for rendering a cube
-    unsigned int cubeIndices[] = {
+    const unsigned int cubeIndices[] = {
         0, 1, 3,  // Triangle 1
         1, 2, 3,   // Triangle 2
         4,5,6,
@@ -898,536 +1236,836 @@ void createMesh(GLMesh &mesh) {
         
     };
 
-    float cardVerts[]{
+    const float cardVerts[]{
          0.3f,  0.55f, 0.5f,   1.0f, 0.0f, 0.0f, 1.0f,   1.0f, 1.0f, // Top Right Vertex 0
          0.3f,  0.55f,-0.5f,   0.0f, 1.0f, 0.0f, 1.0f,   1.0f, 0.0f, // Bottom Right Vertex 1
         -0.3f,  0.55f,-0.5f,   0.0f, 0.0f, 1.0f, 1.0f,   0.0f, 0.0f, // Bottom Left Vertex 2
         -0.3f,  0.55f, 0.5f,   1.0f, 0.0f, 1.0f, 1.0f,   0.0f, 1.0f,  // Top Left Vertex 3
     };
 
-    unsigned int cardIndices[]{
+    const unsigned int cardIndices[]{
 		0, 1, 3,  // Triangle 1
 		1, 2, 3   // Triangle 2
 	};
 
-    catColor.redValue = 1.0f;
-    catColor.greenValue = 1.0f;
-    catColor.blueValue = 1.0f;
-    catColor.alphaValue = 1.0f;
-
-    // Shapes for the cat
-    // Generates the first sphere's vertices and indices
-    std::vector<float> sphereVertices1 = genSphereVerts(0.5625, catColor);
-    std::vector<unsigned int> sphereIndices1 = genSphereIndices();
-
-    // Generates the third cylinder's vertices and indices
-    std::vector<float> cylVertices3 = genCylSideVerts(sides, 1.4375f, 0.5625f, catColor);
-    std::vector<unsigned int> cylIndices3 = genCylSideIndices(sides);
-
-    // Generate the pyramid/cone vertices and indices
-    std::vector<float> coneVerts1 = genPyramidVerts(sides, 0.5f, 0.25f, catColor);
-    std::vector<unsigned int> conIndices1 = genPyramidIndices(sides);
-
-    std::vector<float> cylVertices4 = genCylSideVerts(sides, 1.1f, 0.1f, catColor);
-    std::vector<unsigned int> cylIndices4 = genCylSideIndices(sides);
-
-
-    // Initialize buffers
-    glGenVertexArrays(14, mesh.VAOs);
-    glGenBuffers(14, mesh.VBOs);
-    glGenBuffers(14, mesh.EBOs);
-
-    // First Cylinder Sides
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[0]);
-
-    // VBO of the first cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[0]);
-    glBufferData(GL_ARRAY_BUFFER, cylSideVertices1.size() * sizeof(float), cylSideVertices1.data(), GL_STATIC_DRAW);
-
-    // EBO of the first cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[0]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylSideIndices1.size() * sizeof(unsigned int), cylSideIndices1.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // First Cylinder Top
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[1]);
-
-    // VBO of the top of the first cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[1]);
-    glBufferData(GL_ARRAY_BUFFER, cylTopVertices1.size() * sizeof(float), cylTopVertices1.data(), GL_STATIC_DRAW);
-
-    // EBO of the first cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylTopIndices1.size() * sizeof(unsigned int), cylTopIndices1.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // First Cylinder Bottom
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[2]);
-
-    // VBO of the bottom of the first cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[2]);
-    glBufferData(GL_ARRAY_BUFFER, cylBottomVertices1.size() * sizeof(float), cylBottomVertices1.data(), GL_STATIC_DRAW);
-
-    // EBO of the first cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[2]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylBottomIndices1.size() * sizeof(unsigned int), cylBottomIndices1.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Second Cylinder Sides
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[3]);
-
-    // VBO of the sides of the second cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[3]);
-    glBufferData(GL_ARRAY_BUFFER, cylSideVertices2.size() * sizeof(float), cylSideVertices2.data(), GL_STATIC_DRAW);
-
-    // EBOs of second cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[3]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylSideIndices2.size() * sizeof(unsigned int), cylSideIndices2.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Second Cylinder Top
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[4]);
-
-    // VBO of the Top of the second cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[4]);
-    glBufferData(GL_ARRAY_BUFFER, cylTopVertices2.size() * sizeof(float), cylTopVertices2.data(), GL_STATIC_DRAW);
-
-    // EBOs of second cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[4]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylTopIndices2.size() * sizeof(unsigned int), cylTopIndices2.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Second Cylinder Bottom
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[5]);
-
-    // VBO of the bottom of the second cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[5]);
-    glBufferData(GL_ARRAY_BUFFER, cylBottomVertices2.size() * sizeof(float), cylBottomVertices2.data(), GL_STATIC_DRAW);
-
-    // EBOs of second cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[5]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylBottomIndices2.size() * sizeof(unsigned int), cylBottomIndices2.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // First Cube (Third Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[6]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[6]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(PyramidVerts), PyramidVerts, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Plane (Fourth Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[7]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[7]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVerts), planeVerts, GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[7]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(planeIndices), planeIndices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Spheres (Fifth Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[8]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[8]);
-    glBufferData(GL_ARRAY_BUFFER, sphereVertices1.size() * sizeof(float), sphereVertices1.data(), GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[8]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices1.size() * sizeof(unsigned int), sphereIndices1.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Third Cylinder (Sixth Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[9]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[9]);
-    glBufferData(GL_ARRAY_BUFFER, cylVertices3.size() * sizeof(float), cylVertices3.data(), GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[9]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylIndices3.size() * sizeof(unsigned int), cylIndices3.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Cones (Seventh Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[10]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[10]);
-    glBufferData(GL_ARRAY_BUFFER, coneVerts1.size() * sizeof(float), coneVerts1.data(), GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[10]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, conIndices1.size() * sizeof(unsigned int), conIndices1.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // Cube (Seventh Object)
-// bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[11]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[11]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[11]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    // Plane (Fourth Object)
-    // bind the Vertex Array Object
-    glBindVertexArray(mesh.VAOs[12]);
-
-    // VBO of the cube
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[12]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cardVerts), cardVerts, GL_STATIC_DRAW);
-
-    // EBO of cube
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[12]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cardIndices), cardIndices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-    glBindVertexArray(mesh.VAOs[13]);
-
-    // VBO of the first cylinder
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBOs[13]);
-    glBufferData(GL_ARRAY_BUFFER, cylVertices4.size() * sizeof(float), cylVertices4.data(), GL_STATIC_DRAW);
-
-    // EBO of the first cylinder
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBOs[13]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylIndices4.size() * sizeof(unsigned int), cylIndices4.data(), GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attibute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-
-
-    mesh.indexCounts[0] = cylSideIndices1.size();
-    mesh.indexCounts[1] = cylTopIndices2.size();
-    mesh.indexCounts[2] = cylBottomIndices1.size();
-    mesh.indexCounts[3] = cylSideIndices2.size();
-    mesh.indexCounts[4] = cylTopIndices2.size();
-    mesh.indexCounts[5] = cylBottomIndices2.size();
-    mesh.indexCounts[7] = sizeof(planeIndices) / sizeof(unsigned int);
-    mesh.indexCounts[8] = sphereIndices1.size();
-    mesh.indexCounts[9] = cylIndices3.size();
-    mesh.indexCounts[10] = coneVerts1.size();
-    mesh.indexCounts[11] = sizeof(cubeIndices) / sizeof(unsigned int);
-    mesh.indexCounts[12] = sizeof(cardIndices) / sizeof(unsigned int);
-    mesh.indexCounts[13] = cylIndices4.size();
-}
-
-// Function to generate the side veritces of a cylinder
-std::vector<float> genCylSideVerts(int sides, float height, float radius, color color) {
-
-    std::vector<float> vertices;
-
-    float angleStep = 2.0f * PI / sides;
+    // The pyramid is a triangle soup, so its indices just count through the vertices
+    constexpr auto pyramidIndices = makeSequentialIndices<sizeof(PyramidVerts) / sizeof(float) / MeshRegistry::FLOATS_PER_VERTEX>();
 
-    float halfHeight = height / 2.0f;
-    
+    // Color of a mesh as the static_mesh.h generators take it
+    constexpr std::array<float, 4> toRgba(color c)
+    {
+        return { c.redValue, c.greenValue, c.blueValue, c.alphaValue };
+    }
 
-    // Bottom circle vertices
-    for (int i = 0; i < sides; ++i) {
-        float angle = i * angleStep;
-        float x = radius * cos(angle);
-        float z = radius * sin(angle);
+    // One level of a procedural mesh at the given resolution, same arguments as addGeneratedLods
+    template <MeshId Mesh, int Sides>
+    constexpr auto makeStaticLodVertices()
+    {
+        constexpr ProceduralMesh desc = PROCEDURAL_MESHES[Mesh];
+        constexpr std::array<float, 4> rgba = toRgba(desc.meshColor);
+        if constexpr (desc.shape == SHAPE_CYLINDER_SIDE)
+            return makeCylinderSideVertices<Sides>(desc.height, desc.radius, rgba);
+        else if constexpr (desc.shape == SHAPE_CYLINDER_TOP)
+            return makeCapVertices<Sides>(desc.height / 2.0f, desc.radius, rgba);
+        else if constexpr (desc.shape == SHAPE_CYLINDER_BOTTOM)
+            return makeCapVertices<Sides>(-desc.height / 2.0f, desc.radius, rgba);
+        else if constexpr (desc.shape == SHAPE_SPHERE)
+            return makeSphereVertices<Sides, Sides>(desc.radius, rgba);
+        else
+            return makeConeVertices<Sides>(desc.height, desc.radius, rgba);
+    }
 
-        // Position
-        vertices.push_back(x);
-        vertices.push_back(-halfHeight); // y (bottom)
-        vertices.push_back(z);
+    template <MeshId Mesh, int Sides>
+    constexpr auto makeStaticLodIndices()
+    {
+        constexpr ProceduralShape shape = PROCEDURAL_MESHES[Mesh].shape;
+        if constexpr (shape == SHAPE_CYLINDER_SIDE)
+            return makeCylinderSideIndices<Sides>();
+        else if constexpr (shape == SHAPE_CYLINDER_TOP || shape == SHAPE_CYLINDER_BOTTOM)
+            return makeCapIndices<Sides>();
+        else if constexpr (shape == SHAPE_SPHERE)
+            return makeSphereIndices<Sides, Sides>();
+        else
+            return makeSequentialIndices<Sides * 9>();
+    }
 
-        // Color 
-        vertices.push_back(color.redValue);     // r
-        vertices.push_back(color.greenValue);   // g
-        vertices.push_back(color.blueValue);    // b
-        vertices.push_back(color.alphaValue);   // a
+    // The compile-time tables, one per mesh and level
+    template <MeshId Mesh, int Sides>
+    constexpr auto staticLodVertices = makeStaticLodVertices<Mesh, Sides>();
+    template <MeshId Mesh, int Sides>
+    constexpr auto staticLodIndices = makeStaticLodIndices<Mesh, Sides>();
 
-        vertices.push_back(static_cast<float>(i) / static_cast<float>(sides));    // u
-        vertices.push_back(0.0f);   // v
+    // Calls visit(level, vertices, indices) for every level of a procedural mesh, coarsest first
+    template <MeshId Mesh, typename Visitor>
+    void forEachStaticLod(Visitor visit)
+    {
+        visit(0, staticLodVertices<Mesh, STATIC_LOD_SIDES[0]>, staticLodIndices<Mesh, STATIC_LOD_SIDES[0]>);
+        visit(1, staticLodVertices<Mesh, STATIC_LOD_SIDES[1]>, staticLodIndices<Mesh, STATIC_LOD_SIDES[1]>);
+        visit(2, staticLodVertices<Mesh, STATIC_LOD_SIDES[2]>, staticLodIndices<Mesh, STATIC_LOD_SIDES[2]>);
+        visit(3, staticLodVertices<Mesh, STATIC_LOD_SIDES[3]>, staticLodIndices<Mesh, STATIC_LOD_SIDES[3]>);
     }
+    static_assert(LOD_COUNT == 4, "forEachStaticLod visits every level");
 
-    // Top circle vertices
-    for (int i = 0; i < sides; ++i) {
-        float angle = i * angleStep;
-        float x = radius * cos(angle);
-        float z = radius * sin(angle);
-
-        // Position
-        vertices.push_back(x);
-        vertices.push_back(halfHeight); // y (top)
-        vertices.push_back(z);
-
-        // Color 
-        vertices.push_back(color.redValue);     // r
-        vertices.push_back(color.greenValue);   // g
-        vertices.push_back(color.blueValue);    // b
-        vertices.push_back(color.alphaValue);   // a
-        
-
-        vertices.push_back(static_cast<float>(i) / static_cast<float>(sides));    // u
-        vertices.push_back(1.0f);   // v
+    // Adds every level of a procedural mesh to the registry
+    template <MeshId Mesh>
+    void addStaticLods(MeshRegistry& meshes)
+    {
+        forEachStaticLod<Mesh>([&](int, const auto& vertices, const auto& indices) { meshes.add(vertices, indices); });
     }
 
-    return vertices;
+    // Chains the vertices of every level of a procedural mesh into a hash
+    template <MeshId Mesh>
+    std::uint64_t hashStaticLods(std::uint64_t key)
+    {
+        forEachStaticLod<Mesh>([&](int, const auto& vertices, const auto&) { key = hashBytes(vertices.data(), sizeof(vertices), key); });
+        return key;
+    }
 }
 
-// Function to generate the top veritces of a cylinder
-std::vector<float> genCylTopVerts(int sides, float height, float radius, color color) {
-
-    std::vector<float> vertices;
+// Function to start building the meshes on the workers
+// Without workers createMesh builds them itself
+void startMeshBuild() {
 
-    float angleStep = 2.0f * PI / sides;
+    if (workers)
+        meshBuild = workers->submit([] { return buildMeshes(meshes); });
+}
 
-    float halfHeight = height / 2.0f;
+// Function to build the meshes on the CPU
+// Needs no GL context, so it runs on a worker during startup; returns true when the cache file already holds the meshes
+bool buildMeshes(MeshRegistry& meshes) {
 
-    // Top circle vertices
-    for (int i = 0; i < sides; ++i) {
-        float angle = i * angleStep;
-        float x = radius * cos(angle);
-        float z = radius * sin(angle);
+    auto start = std::chrono::steady_clock::now();
+    meshes.Format = vertexFormat;
 
-        // Position
-        vertices.push_back(x);
-        vertices.push_back(halfHeight); // y (top)
-        vertices.push_back(z);
+    // An earlier run left the finished buffers behind, createMesh maps them straight to the GPU
+    meshKey = meshCacheKey();
+    if (!meshCachePath.empty() && MeshCache::matches(meshCachePath, meshKey, vertexFormat, registryMeshCount()))
+    {
+        meshSource = "cache";
+        meshBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
 
-        // Color 
-        vertices.push_back(color.redValue);     // r
-        vertices.push_back(color.greenValue);   // g
-        vertices.push_back(color.blueValue);    // b
-        vertices.push_back(color.alphaValue);   // a
+    // All size values are 1/4 of real life sizes in inches
 
+    // The compiler already generated the default resolutions, anything else is generated here;
+    // pulled meshes need no vertices at all
+    if (vertexPulling)
+    {
+        addPulledMeshes(meshes);
+        meshSource = "pulled";
+    }
+    else if (std::equal(lodSides, lodSides + LOD_COUNT, STATIC_LOD_SIDES))
+    {
+        addStaticMeshes(meshes);
+        meshSource = "static";
+    }
+    else
+    {
+        addGeneratedMeshes(meshes);
+        meshSource = "generated";
+    }
+
+    // Shared corners of triangle soups become one vertex; the cache file stores the result, so hits skip this too
+    if (vertexWeld)
+        meshes.weldVertices(MESH_WELD_TOLERANCE, WorkerForEach());
+    // Triangles are drawn in vertex cache order
+    if (vertexCacheOrder)
+        meshes.optimizeVertexCache(VERTEX_CACHE_SIZE, WorkerForEach());
+
+    if (!meshCachePath.empty())
+        MeshCache::save(meshes, meshCachePath, meshKey);
+
+    meshBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return false;
+}
+
+// Function to create mesh
+// Waits for the build started by startMeshBuild, then uploads on the context thread
+void createMesh(MeshRegistry& meshes) {
 
-        // Texture coordinates for the top circle
-        vertices.push_back(0.5f + 0.5f * cos(angle));  // u
-        vertices.push_back(0.5f + 0.5f * sin(angle));  // v
+    bool cached = meshBuild.valid() ? meshBuild.get() : buildMeshes(meshes);
+    if (cached && !MeshCache::load(meshes, meshCachePath, meshKey, registryMeshCount()))
+    {
+        // the file changed since the build checked it, build without it
+        meshCachePath.clear();
+        buildMeshes(meshes);
+        cached = false;
     }
-    
-    // For triangle fan
-    float y =  halfHeight; 
-
-    // Position
-    vertices.push_back(0.0f);  // x
-    vertices.push_back(y);     // y
-    vertices.push_back(0.0f);  // z
-
-    // Color 
-    vertices.push_back(color.redValue);     // r
-    vertices.push_back(color.greenValue);   // g
-    vertices.push_back(color.blueValue);    // b
-    vertices.push_back(color.alphaValue);   // a
-         
-
-    // Texture coordinates for the center points
-    vertices.push_back(0.5f);  // u (center point)
-    vertices.push_back(0.5f);  // v (center point)
-        
-    return vertices;
+
+    // One VBO, one EBO and one VAO for the whole scene, loading the cache already created them
+    if (!cached)
+        meshes.upload();
+
+    // Pulled meshes read no attributes, but core profiles still need a vertex array bound
+    if (vertexPulling)
+        glGenVertexArrays(1, &pullingVAO);
+
+    // Both vertex arrays read the per-draw data from the same buffer
+    instanceBuffer.create(64);
+    instanceBuffer.attach(meshes.VAO);
+    if (vertexPulling)
+        instanceBuffer.attach(pullingVAO);
+    glBindVertexArray(0);
+
+    // Camera and light data for every draw
+    frameUniforms.create();
+
+    if (multiDrawIndirect)
+        indirectBuffer.create(64);
 }
 
-// Function to generate the bottom veritces of a cylinder
-std::vector<float> genCylBottomVerts(int sides, float height, float radius, color color) {
+// Function to hash everything the meshes are generated from
+// Covers the resolutions, the vertex layout, the generator arguments, the hand-written meshes and the
+// compile-time tables; bump MESH_GENERATOR_REVISION when a runtime generator changes
+std::uint64_t meshCacheKey() {
+
+    const int MESH_GENERATOR_REVISION = 2;
+    const int settings[] = { MESH_GENERATOR_REVISION, LOD_COUNT, static_cast<int>(vertexFormat),
+        meshKernelsVectorized() ? 1 : 0, vertexCacheOrder ? VERTEX_CACHE_SIZE : 0, vertexPulling ? 1 : 0 };
+    std::uint64_t key = hashBytes(settings, sizeof(settings));
+    const float weldTolerance = vertexWeld ? MESH_WELD_TOLERANCE : -1.0f;
+    key = hashBytes(&weldTolerance, sizeof(weldTolerance), key);
+    key = hashBytes(lodSides, sizeof(lodSides), key);
+    key = hashBytes(PROCEDURAL_MESHES, sizeof(PROCEDURAL_MESHES), key);
+
+    key = hashBytes(PyramidVerts, sizeof(PyramidVerts), key);
+    key = hashBytes(planeVerts, sizeof(planeVerts), key);
+    key = hashBytes(planeIndices, sizeof(planeIndices), key);
+    key = hashBytes(cubeVertices, sizeof(cubeVertices), key);
+    key = hashBytes(cubeIndices, sizeof(cubeIndices), key);
+    key = hashBytes(cardVerts, sizeof(cardVerts), key);
+    key = hashBytes(cardIndices, sizeof(cardIndices), key);
+
+    key = hashStaticLods<MESH_CYL1_SIDE>(key);
+    key = hashStaticLods<MESH_CYL1_TOP>(key);
+    key = hashStaticLods<MESH_CYL1_BOTTOM>(key);
+    key = hashStaticLods<MESH_CYL2_SIDE>(key);
+    key = hashStaticLods<MESH_CYL2_TOP>(key);
+    key = hashStaticLods<MESH_CYL2_BOTTOM>(key);
+    key = hashStaticLods<MESH_SPHERE>(key);
+    key = hashStaticLods<MESH_CYL3_SIDE>(key);
+    key = hashStaticLods<MESH_CONE>(key);
+    key = hashStaticLods<MESH_CYL4_SIDE>(key);
+
+    return key;
+}
 
-    std::vector<float> vertices;
+// Function to add the compile-time meshes to the registry
+// Same order as addGeneratedMeshes, no math and no allocation besides the registry's own buffers
+void addStaticMeshes(MeshRegistry& meshes) {
+
+    // Sub-allocate every mesh into the shared buffers, in MeshId order, the levels of a procedural mesh next to each other
+    addStaticLods<MESH_CYL1_SIDE>(meshes);
+    addStaticLods<MESH_CYL1_TOP>(meshes);
+    addStaticLods<MESH_CYL1_BOTTOM>(meshes);
+    addStaticLods<MESH_CYL2_SIDE>(meshes);
+    addStaticLods<MESH_CYL2_TOP>(meshes);
+    addStaticLods<MESH_CYL2_BOTTOM>(meshes);
+    addAuthoredMesh(meshes, MESH_PYRAMID);
+    addAuthoredMesh(meshes, MESH_PLANE);
+    addStaticLods<MESH_SPHERE>(meshes);
+    addStaticLods<MESH_CYL3_SIDE>(meshes);
+    addStaticLods<MESH_CONE>(meshes);
+    addAuthoredMesh(meshes, MESH_CUBE);
+    addAuthoredMesh(meshes, MESH_CARD);
+    addStaticLods<MESH_CYL4_SIDE>(meshes);
+}
+
+// Function to generate the meshes at the current resolutions and add them to the registry
+void addGeneratedMeshes(MeshRegistry& meshes) {
+
+    // Every level of every procedural mesh is independent, so they are generated on the workers
+    struct LodJob
+    {
+        MeshId mesh;
+        int sides;
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+    };
+    std::vector<LodJob> jobs;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+        if (PROCEDURAL_MESHES[mesh].shape != SHAPE_NONE)
+            for (int level = 0; level < LOD_COUNT; ++level)
+                jobs.push_back({ static_cast<MeshId>(mesh), lodSides[level] });
+
+    WorkerForEach()(jobs.size(), [&](size_t i) {
+        jobs[i].vertices = genLodVerts(jobs[i].mesh, jobs[i].sides);
+        jobs[i].indices = genLodIndices(jobs[i].mesh, jobs[i].sides);
+    });
+
+    // Sub-allocate every mesh into the shared buffers, in MeshId order, the levels of a procedural mesh next to each other
+    size_t job = 0;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        if (PROCEDURAL_MESHES[mesh].shape == SHAPE_NONE)
+        {
+            addAuthoredMesh(meshes, static_cast<MeshId>(mesh));
+            continue;
+        }
+        for (int level = 0; level < LOD_COUNT; ++level, ++job)
+            meshes.add(jobs[job].vertices, jobs[job].indices);
+    }
+}
+
+// Function to add only the hand-written meshes, for vertex pulling
+// Procedural meshes keep their registry entries, empty, so registryMesh still finds the others
+void addPulledMeshes(MeshRegistry& meshes) {
+
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        if (PROCEDURAL_MESHES[mesh].shape == SHAPE_NONE)
+            addAuthoredMesh(meshes, static_cast<MeshId>(mesh));
+        else
+            for (int level = 0; level < LOD_COUNT; ++level)
+                meshes.add(nullptr, 0, nullptr, 0);
+    }
+}
+
+// Function to add a hand-written mesh to the registry
+void addAuthoredMesh(MeshRegistry& meshes, MeshId mesh) {
+
+    switch (mesh)
+    {
+    case MESH_PYRAMID:
+        meshes.add(PyramidVerts, sizeof(PyramidVerts) / sizeof(float), pyramidIndices.data(), pyramidIndices.size());
+        break;
+    case MESH_PLANE:
+        meshes.add(planeVerts, sizeof(planeVerts) / sizeof(float), planeIndices, sizeof(planeIndices) / sizeof(unsigned int));
+        break;
+    case MESH_CUBE:
+        meshes.add(cubeVertices, sizeof(cubeVertices) / sizeof(float), cubeIndices, sizeof(cubeIndices) / sizeof(unsigned int));
+        break;
+    case MESH_CARD:
+        meshes.add(cardVerts, sizeof(cardVerts) / sizeof(float), cardIndices, sizeof(cardIndices) / sizeof(unsigned int));
+        break;
+    default:
+        break;
+    }
+}
 
-    float angleStep = 2.0f * PI / sides;
+// Function to generate the vertices of one level of a procedural mesh
+std::vector<float> genLodVerts(MeshId mesh, int sides) {
+
+    const ProceduralMesh& desc = PROCEDURAL_MESHES[mesh];
+    switch (desc.shape)
+    {
+    case SHAPE_CYLINDER_SIDE:
+        return genCylSideVerts(sides, desc.height, desc.radius, desc.meshColor);
+    case SHAPE_CYLINDER_TOP:
+        return genCylTopVerts(sides, desc.height, desc.radius, desc.meshColor);
+    case SHAPE_CYLINDER_BOTTOM:
+        return genCylBottomVerts(sides, desc.height, desc.radius, desc.meshColor);
+    case SHAPE_SPHERE:
+        return genSphereVerts(sides, sides, desc.radius, desc.meshColor);
+    case SHAPE_CONE:
+        return genPyramidVerts(sides, desc.height, desc.radius, desc.meshColor);
+    default:
+        return std::vector<float>();
+    }
+}
+
+// Function to generate the indices of one level of a procedural mesh
+std::vector<unsigned int> genLodIndices(MeshId mesh, int sides) {
+
+    switch (PROCEDURAL_MESHES[mesh].shape)
+    {
+    case SHAPE_CYLINDER_SIDE:
+        return genCylSideIndices(sides);
+    case SHAPE_CYLINDER_TOP:
+        return genCylTopIndices(sides);
+    case SHAPE_CYLINDER_BOTTOM:
+        return genCylBottomIndices(sides);
+    case SHAPE_SPHERE:
+        return genSphereIndices(sides, sides);
+    case SHAPE_CONE:
+        // The cone is a triangle soup of three triangles per side, so its indices just count through the vertices
+        return genSequentialIndices(sides * 9);
+    default:
+        return std::vector<unsigned int>();
+    }
+}
+
+// Function to find a level of a mesh in the registry
+// Hand-written meshes have one entry, procedural ones LOD_COUNT in a row
+int registryMesh(MeshId mesh, int level) {
+
+    int entry = 0;
+    for (int i = 0; i < mesh; ++i)
+        entry += PROCEDURAL_MESHES[i].shape == SHAPE_NONE ? 1 : LOD_COUNT;
+    return PROCEDURAL_MESHES[mesh].shape == SHAPE_NONE ? entry : entry + level;
+}
+
+// Function to count the entries of the registry
+// Every build adds a level per procedural mesh, pulled meshes as empty ones, so this is the same for all
+int registryMeshCount() {
+
+    int count = 0;
+    for (const ProceduralMesh& mesh : PROCEDURAL_MESHES)
+        count += mesh.shape == SHAPE_NONE ? 1 : LOD_COUNT;
+    return count;
+}
+
+// Function to measure the radius of a procedural mesh on screen
+// In pixels, from the current projection and camera; infinite when the camera is inside the mesh's bounds
+float projectedRadius(MeshId mesh, const glm::mat4& model) {
+
+    // bounding circle in world space, the largest axis scale keeps it conservative
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    float radius = PROCEDURAL_MESHES[mesh].radius * scale;
+
+    // projection[1][1] maps view space to NDC, which is half the viewport tall
+    float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    // perspective projections shrink with the distance, orthographic ones do not
+    if (projection[3][3] == 0.0f)
+    {
+        float distance = glm::length(glm::vec3(model[3]) - camera.Position);
+        if (distance <= radius)
+            return std::numeric_limits<float>::infinity();
+        pixelsPerUnit /= distance;
+    }
+    return radius * pixelsPerUnit;
+}
+
+// Function to pick the level of detail of a procedural mesh
+// A circle drawn with n sides is at most r * (1 - cos(pi / n)) inside the true one, the coarsest
+// level that keeps this under LOD_PIXEL_ERROR at the mesh's projected radius r is used
+int selectLod(MeshId mesh, const glm::mat4& model) {
+
+    if (forcedLod >= 0)
+        return forcedLod;
+
+    float pixelRadius = projectedRadius(mesh, model);
+    for (int level = 0; level < LOD_COUNT - 1; ++level)
+    {
+        if (pixelRadius * (1.0f - std::cos(PI / lodSides[level])) <= LOD_PIXEL_ERROR)
+            return level;
+    }
+    return LOD_COUNT - 1;
+}
+
+// Function to pick the number of sides of a pulled procedural mesh
+// Same error bound as selectLod, but any count between the coarsest and finest level can be drawn
+int selectPulledSides(MeshId mesh, const glm::mat4& model) {
+
+    if (forcedLod >= 0)
+        return lodSides[forcedLod];
+
+    float pixelRadius = projectedRadius(mesh, model);
+    int finest = lodSides[LOD_COUNT - 1];
+    if (pixelRadius <= LOD_PIXEL_ERROR)
+        return lodSides[0];
+    if (pixelRadius == std::numeric_limits<float>::infinity())
+        return finest;
+    // solve r * (1 - cos(pi / n)) = error for n
+    float sides = PI / std::acos(1.0f - LOD_PIXEL_ERROR / pixelRadius);
+    return std::max(lodSides[0], std::min(finest, static_cast<int>(std::ceil(sides))));
+}
+
+// Function to queue a mesh at the level of detail its screen size needs
+// Procedural meshes are queued as pulled draws when vertex pulling is on. The transform and the
+// material go into the frame's instance data, so the draw is a single instance and sets no uniforms.
+void queueMesh(Shader& ourShader, MeshId mesh, const glm::mat4& model, unsigned int material) {
+
+    bool procedural = PROCEDURAL_MESHES[mesh].shape != SHAPE_NONE;
+    bool pulled = vertexPulling && procedural;
+
+    DrawItem item = {};
+    item.program = ourShader.ID;
+    item.texture = materialArray.ID;
+    item.vertexArray = pulled ? pullingVAO : meshes.VAO;
+    item.mesh = mesh;
+    item.level = !procedural ? 0 : pulled ? selectPulledSides(mesh, model) : selectLod(mesh, model);
+    item.baseInstance = static_cast<unsigned int>(frameInstances.size());
+    item.instanceCount = 1;
+    frameInstances.push_back({ model, material });
+    drawList.add(item, mesh, viewDepth(model));
+}
+
+// Function to queue copies of a mesh as one instanced draw per level of detail
+// Copies that need the same level (or pulled side count) share a draw; instances is reordered by
+// level on the way and appended to the frame's instance data. Without instancing every copy is
+// queued on its own.
+void queueInstances(Shader& ourShader, MeshId mesh, std::vector<MeshInstance>& instances) {
+
+    if (instances.empty())
+        return;
+
+    if (!instancing)
+    {
+        // one draw per copy, as before instancing
+        for (const MeshInstance& instance : instances)
+            queueMesh(ourShader, mesh, instance.model, instance.material);
+        return;
+    }
+
+    // level of every copy, as a registry level or a pulled side count
+    bool procedural = PROCEDURAL_MESHES[mesh].shape != SHAPE_NONE;
+    bool pulled = vertexPulling && procedural;
+    auto levelOf = [&](const MeshInstance& instance) {
+        if (!procedural)
+            return 0;
+        return pulled ? selectPulledSides(mesh, instance.model) : selectLod(mesh, instance.model);
+    };
+    std::vector<std::pair<int, size_t>> levels(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i)
+        levels[i] = { levelOf(instances[i]), i };
+    std::sort(levels.begin(), levels.end());
+    std::vector<MeshInstance> sorted(instances.size());
+    for (size_t i = 0; i < levels.size(); ++i)
+        sorted[i] = instances[levels[i].second];
+    instances.swap(sorted);
+
+    // offsets are into frameInstances, submitDrawList uploads it in one piece
+    unsigned int firstInstance = static_cast<unsigned int>(frameInstances.size());
+    frameInstances.insert(frameInstances.end(), instances.begin(), instances.end());
+
+    DrawItem item = {};
+    item.program = ourShader.ID;
+    item.texture = materialArray.ID;
+    item.vertexArray = pulled ? pullingVAO : meshes.VAO;
+    item.mesh = mesh;
+    for (size_t begin = 0, end = 0; begin < levels.size(); begin = end)
+    {
+        item.level = levels[begin].first;
+        float depth = 1.0f;
+        while (end < levels.size() && levels[end].first == item.level)
+            depth = std::min(depth, viewDepth(instances[end++].model));
+
+        item.baseInstance = firstInstance + static_cast<unsigned int>(begin);
+        item.instanceCount = static_cast<unsigned int>(end - begin);
+        // a run is as near as its nearest copy
+        drawList.add(item, mesh, depth);
+    }
+}
+
+// Function to draw the queued items in state order
+// Binds a program, texture or vertex array only when it differs from the one already bound and
+// leaves the shape at SHAPE_NONE for the next frame. Every draw is instanced, its base instance
+// picks its transform and material, so nothing per draw goes through uniforms. With multi-draw
+// indirect, consecutive registry items that bind the same state are one call.
+void submitDrawList(Shader& ourShader) {
+
+    drawList.sort();
+    const std::vector<DrawItem>& items = drawList.items();
+    auto pulledItem = [](const DrawItem& item) {
+        return vertexPulling && PROCEDURAL_MESHES[item.mesh].shape != SHAPE_NONE;
+    };
+
+    // the whole frame's instance data in one write, after every draw is queued
+    unsigned int instanceBase = 0;
+    if (!frameInstances.empty())
+    {
+        instanceBuffer.beginFrame();
+        instanceBase = instanceBuffer.write(frameInstances.data(), frameInstances.size());
+    }
+
+    // one indirect command per item in list order, pulled items draw without theirs
+    if (multiDrawIndirect)
+    {
+        drawCommands.assign(items.size(), DrawElementsIndirectCommand());
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            if (pulledItem(items[i]))
+                continue;
+            const MeshRange& range = meshes.range(registryMesh(static_cast<MeshId>(items[i].mesh), items[i].level));
+            drawCommands[i] = { range.indexCount, items[i].instanceCount, range.firstIndex, range.baseVertex, instanceBase + items[i].baseInstance };
+        }
+        indirectBuffer.upload(drawCommands.data(), drawCommands.size());
+    }
+
+    // what is bound; 0 is never a real name, so the first item binds everything
+    unsigned int program = 0;
+    unsigned int vertexArray = 0;
+    unsigned int texture = 0;
+    int shape = SHAPE_NONE;
+    int pulledMesh = -1;
+    int pulledSides = 0;
+    int pulledVertices = 0;
+
+    for (size_t i = 0; i < items.size();)
+    {
+        const DrawItem& item = items[i];
+        if (item.program != program)
+        {
+            glUseProgram(item.program);
+            program = item.program;
+            frameCounters.stateChanges++;
+        }
+
+        if (item.texture != texture)
+        {
+            // one bind per wrap mode's unit
+            textureSamplers.bind(GL_TEXTURE_2D_ARRAY, item.texture);
+            texture = item.texture;
+            frameCounters.stateChanges += WRAP_COUNT;
+        }
+
+        if (item.vertexArray != vertexArray)
+        {
+            glBindVertexArray(item.vertexArray);
+            vertexArray = item.vertexArray;
+            frameCounters.stateChanges++;
+        }
+
+        GLsizei instanceCount = static_cast<GLsizei>(item.instanceCount);
+        unsigned int baseInstance = instanceBase + item.baseInstance;
+
+        MeshId mesh = static_cast<MeshId>(item.mesh);
+        if (pulledItem(item))
+        {
+            if (item.mesh != pulledMesh || item.level != pulledSides)
+            {
+                pulledVertices = bindPulledMesh(ourShader, mesh, item.level);
+                pulledMesh = item.mesh;
+                pulledSides = item.level;
+                shape = PROCEDURAL_MESHES[mesh].shape;
+            }
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, pulledVertices, instanceCount, baseInstance);
+            frameCounters.triangles += pulledVertices / 3 * instanceCount;
+            ++i;
+        }
+        else
+        {
+            // back to the attributes after a pulled mesh
+            if (shape != SHAPE_NONE)
+            {
+                ourShader.setInt(drawUniforms.shape, SHAPE_NONE);
+                shape = SHAPE_NONE;
+                pulledMesh = -1;
+            }
+            if (multiDrawIndirect)
+            {
+                // the run ends at the first item that needs a bind or is pulled
+                size_t end = i;
+                while (end < items.size() && !pulledItem(items[end]) && items[end].program == item.program &&
+                    items[end].texture == item.texture && items[end].vertexArray == item.vertexArray)
+                {
+                    frameCounters.triangles += drawCommands[end].count / 3 * drawCommands[end].instanceCount;
+                    ++end;
+                }
+                indirectBuffer.draw(i, end - i);
+                i = end;
+            }
+            else
+            {
+                int entry = registryMesh(mesh, item.level);
+                meshes.drawInstanced(entry, instanceCount, baseInstance);
+                frameCounters.triangles += meshes.range(entry).indexCount / 3 * instanceCount;
+                ++i;
+            }
+        }
+        frameCounters.drawCalls++;
+    }
+
+    if (shape != SHAPE_NONE)
+        ourShader.setInt(drawUniforms.shape, SHAPE_NONE);
+}
+
+// Function to measure how far along the view an object is
+// Distance from the camera to the model's origin over the far plane, for front to back sorting
+float viewDepth(const glm::mat4& model) {
+
+    return glm::length(glm::vec3(model[3]) - camera.Position) / FAR_PLANE;
+}
+
+// Function to set up a pulled mesh at a number of sides and return its vertex count
+// Sets the shape uniforms, the empty vertex array must be bound
+int bindPulledMesh(Shader& ourShader, MeshId mesh, int sides) {
+
+    const ProceduralMesh& desc = PROCEDURAL_MESHES[mesh];
+
+    ourShader.setInt(drawUniforms.shape, desc.shape);
+    ourShader.setInt(drawUniforms.sides, sides);
+    ourShader.setFloat(drawUniforms.height, desc.height);
+    ourShader.setFloat(drawUniforms.radius, desc.radius);
+    ourShader.setVec4(drawUniforms.shapeColor, desc.meshColor.redValue, desc.meshColor.greenValue, desc.meshColor.blueValue, desc.meshColor.alphaValue);
+
+    // vertices per side of each shape's triangle list, spheres have sides x sides quads
+    int vertexCount = 0;
+    switch (desc.shape)
+    {
+    case SHAPE_CYLINDER_SIDE: vertexCount = sides * 6; break;
+    case SHAPE_CYLINDER_TOP:
+    case SHAPE_CYLINDER_BOTTOM: vertexCount = sides * 3; break;
+    case SHAPE_SPHERE: vertexCount = sides * sides * 6; break;
+    case SHAPE_CONE: vertexCount = sides * 9; break;
+    case SHAPE_NONE: break;
+    }
+
+    return vertexCount;
+}
+
+// Function to compute the bounding volumes of every mesh
+// Procedural meshes from their descriptor, every level's vertices lie on the same circle of
+// radius and between the same caps; hand-written meshes from their vertices
+void computeMeshBounds() {
+
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        const ProceduralMesh& desc = PROCEDURAL_MESHES[mesh];
+        float r = desc.radius;
+        float halfHeight = desc.height / 2.0f;
+        switch (desc.shape)
+        {
+        case SHAPE_CYLINDER_SIDE:
+        case SHAPE_CONE:
+            meshBounds[mesh] = boundsFromBox(glm::vec3(-r, -halfHeight, -r), glm::vec3(r, halfHeight, r));
+            break;
+        case SHAPE_CYLINDER_TOP:
+            meshBounds[mesh] = boundsFromBox(glm::vec3(-r, halfHeight, -r), glm::vec3(r, halfHeight, r));
+            break;
+        case SHAPE_CYLINDER_BOTTOM:
+            meshBounds[mesh] = boundsFromBox(glm::vec3(-r, -halfHeight, -r), glm::vec3(r, -halfHeight, r));
+            break;
+        case SHAPE_SPHERE:
+            meshBounds[mesh] = boundsFromBox(glm::vec3(-r), glm::vec3(r));
+            meshBounds[mesh].radius = r;
+            break;
+        case SHAPE_NONE:
+            break;
+        }
+    }
+
+    const int stride = MeshRegistry::FLOATS_PER_VERTEX;
+    meshBounds[MESH_PYRAMID] = boundsFromVertices(PyramidVerts, sizeof(PyramidVerts) / sizeof(float) / stride, stride);
+    meshBounds[MESH_PLANE] = boundsFromVertices(planeVerts, sizeof(planeVerts) / sizeof(float) / stride, stride);
+    meshBounds[MESH_CUBE] = boundsFromVertices(cubeVertices, sizeof(cubeVertices) / sizeof(float) / stride, stride);
+    meshBounds[MESH_CARD] = boundsFromVertices(cardVerts, sizeof(cardVerts) / sizeof(float) / stride, stride);
+}
+
+// Function to add an object to the frame's culling batch
+// Nothing is queued until queueSceneObjects, so the frame's objects fill whole batches of four
+void addSceneObject(std::initializer_list<MeshId> meshes, const glm::mat4& model, unsigned int material) {
+
+    SceneObject object = { {}, 0, model, material };
+    for (MeshId mesh : meshes)
+        object.meshes[object.meshCount++] = mesh;
+    sceneObjects.push_back(object);
+}
+
+// Function to cull the frame's objects in one batch and queue the visible ones
+// Counts every object as visible or culled for the frame statistics
+void queueSceneObjects(Shader& ourShader) {
+
+    if (frustumCulling)
+    {
+        culler.clear();
+        for (const SceneObject& object : sceneObjects)
+            culler.add(meshBounds[object.meshes[0]], object.model);
+        culler.cull();
+    }
+
+    for (size_t i = 0; i < sceneObjects.size(); ++i)
+    {
+        bool visible = !frustumCulling || culler.visible(i);
+        (visible ? frameCounters.visibleObjects : frameCounters.culledObjects)++;
+        if (!visible)
+            continue;
+        const SceneObject& object = sceneObjects[i];
+        for (int mesh = 0; mesh < object.meshCount; ++mesh)
+            queueMesh(ourShader, object.meshes[mesh], object.model, object.material);
+    }
+}
+
+// Function to drop the copies of a mesh that are outside the view frustum
+// All copies are tested together, four at a time; the visible ones keep their order
+void cullInstances(MeshId mesh, std::vector<MeshInstance>& instances) {
+
+    if (frustumCulling)
+    {
+        culler.clear();
+        for (const MeshInstance& instance : instances)
+            culler.add(meshBounds[mesh], instance.model);
+        culler.cull();
+
+        size_t kept = 0;
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            if (culler.visible(i))
+                instances[kept++] = instances[i];
+        }
+        frameCounters.culledObjects += static_cast<unsigned int>(instances.size() - kept);
+        instances.resize(kept);
+    }
+    frameCounters.visibleObjects += static_cast<unsigned int>(instances.size());
+}
+
+// Function to scatter the extra props over the plane
+// Small cat spheres on a square grid resting on the plane, alternating materials
+void placeProps(int count) {
+
+    props.clear();
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float scale = 0.1f;
+    for (int i = 0; i < count; ++i)
+    {
+        float x = -4.5f + 9.0f * ((i % columns) + 0.5f) / columns;
+        float z = -4.5f + 9.0f * ((i / columns) + 0.5f) / columns;
+        glm::mat4 model = glm::translate(glm::vec3(x, -1.0f + PROCEDURAL_MESHES[MESH_SPHERE].radius * scale, z)) * glm::scale(glm::vec3(scale));
+        props.push_back({ model, CAT_MATERIALS[i % 2] });
+    }
+}
+
+
+// Function to generate the side veritces of a cylinder
+std::vector<float> genCylSideVerts(int sides, float height, float radius, color color) {
+
+    // Bottom ring then top ring, written straight into the sized buffer
+    std::vector<float> vertices(sides * 2 * 9);
+    const float rgba[] = { color.redValue, color.greenValue, color.blueValue, color.alphaValue };
+
+    // Shared unit circle for this number of sides
+    const TrigRing& ring = TrigRingCache::get(sides);
 
     float halfHeight = height / 2.0f;
 
     // Bottom circle vertices
-    for (int i = 0; i < sides ; ++i) {
-        float angle = i * angleStep;
-        float x = radius * cos(angle);
-        float z = radius * sin(angle);
-
-        // Position
-        vertices.push_back(x);
-        vertices.push_back(-halfHeight); // y (bottom)
-        vertices.push_back(z);
-
-        // Color 
-        vertices.push_back(color.redValue);     // r
-        vertices.push_back(color.greenValue);   // g
-        vertices.push_back(color.blueValue);    // b
-        vertices.push_back(color.alphaValue);   // a
-        
+    writeCylinderRow(vertices.data(), sides, -halfHeight, 0.0f, radius, rgba, ring.cosines.data(), ring.sines.data());
+    // Top circle vertices
+    writeCylinderRow(vertices.data() + sides * 9, sides, halfHeight, 1.0f, radius, rgba, ring.cosines.data(), ring.sines.data());
 
-        // Texture coordinates for the bottom circle
-        vertices.push_back(0.5f + 0.5f * cos(angle));  // u
-        vertices.push_back(0.5f + 0.5f * sin(angle));  // v
-    }
+    return vertices;
+}
+
+// Function to generate the top veritces of a cylinder
+std::vector<float> genCylTopVerts(int sides, float height, float radius, color color) {
+
+    // Rim vertices followed by the center of the triangle fan
+    std::vector<float> vertices((sides + 1) * 9);
+    const float rgba[] = { color.redValue, color.greenValue, color.blueValue, color.alphaValue };
+
+    // Shared unit circle for this number of sides
+    const TrigRing& ring = TrigRingCache::get(sides);
+
+    float halfHeight = height / 2.0f;
+
+    // Top circle vertices
+    writeCapRow(vertices.data(), sides, halfHeight, radius, rgba, ring.cosines.data(), ring.sines.data());
+
+    // Center point, in the middle of the texture
+    storeVertex(vertices.data() + sides * 9, 0.0f, halfHeight, 0.0f, rgba, 0.5f, 0.5f);
+
+    return vertices;
+}
+
+// Function to generate the bottom veritces of a cylinder
+std::vector<float> genCylBottomVerts(int sides, float height, float radius, color color) {
 
-    // For triangle fan
-    float y = -halfHeight;
+    // Rim vertices followed by the center of the triangle fan
+    std::vector<float> vertices((sides + 1) * 9);
+    const float rgba[] = { color.redValue, color.greenValue, color.blueValue, color.alphaValue };
 
-    // Position
-    vertices.push_back(0.0f);  // x
-    vertices.push_back(y);     // y
-    vertices.push_back(0.0f);  // z
+    // Shared unit circle for this number of sides
+    const TrigRing& ring = TrigRingCache::get(sides);
 
-    // Color 
-    vertices.push_back(color.redValue);     // r
-    vertices.push_back(color.greenValue);   // g
-    vertices.push_back(color.blueValue);    // b
-    vertices.push_back(color.alphaValue);   // a
+    float halfHeight = height / 2.0f;
 
+    // Bottom circle vertices
+    writeCapRow(vertices.data(), sides, -halfHeight, radius, rgba, ring.cosines.data(), ring.sines.data());
 
-    // Texture coordinates for the center points
-    vertices.push_back(0.5f);  // u (center point)
-    vertices.push_back(0.5f);  // v (center point)
+    // Center point, in the middle of the texture
+    storeVertex(vertices.data() + sides * 9, 0.0f, -halfHeight, 0.0f, rgba, 0.5f, 0.5f);
 
     return vertices;
 }
@@ -1494,51 +2132,18 @@ std::vector<unsigned int> genCylTopIndices(int sides) {
 }
 
 // Function for generating a sphere's vertices
-std::vector<float> genSphereVerts(float radius, color color) {
-    std::vector<float> vertices;
-    float phi, theta;
-
-    // Generate vertices and colors for the sphere
-    for (int i = 0; i <= rings; ++i) {
-        phi = static_cast<float>(PI) * i / rings; // Vertical angle
-
-        for (int j = 0; j <= segments; ++j) {
-            theta = static_cast<float>(2 * PI) * j / segments; // Horizontal angle
-
-            // Calculate the vertex position
-            float x = radius * std::sin(phi) * std::cos(theta);
-            float y = radius * std::sin(phi) * std::sin(theta);
-            float z = radius * std::cos(phi);
-
-            // Add the vertex position to the vector
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            // Color 
-            vertices.push_back(color.redValue);     // r
-            vertices.push_back(color.greenValue);   // g
-            vertices.push_back(color.blueValue);    // b
-            vertices.push_back(color.alphaValue);   // a
-
-            // Calculate and push texture coordinates
-            float u = static_cast<float>(j) / segments; // U texture coordinate
-            float v = static_cast<float>(i) / rings;    // V texture coordinate
-            /*
-            float v = 2 * ((y - (-1.0f)) / ((1.0f) - (-1.0f))) - 1;    // V texture coordinate
-            v = v * 1.25;
-            v = v * 0.5 + 0.5;
-            */
-            vertices.push_back(u);
-            vertices.push_back(v);
-        }
-    }
+std::vector<float> genSphereVerts(int rings, int segments, float radius, color color) {
+    std::vector<float> vertices(sphereFloatCount(rings, segments));
+    const float rgba[] = { color.redValue, color.greenValue, color.blueValue, color.alphaValue };
+
+    // Vertices, colors and texture coordinates for every ring and segment
+    writeSphereVertices(vertices.data(), rings, segments, static_cast<float>(PI), radius, rgba);
 
     return vertices;
 }
 
 // Function for generating a sphere's indices
-std::vector<unsigned int> genSphereIndices()
+std::vector<unsigned int> genSphereIndices(int rings, int segments)
 {
     std::vector<unsigned int> indices;
 
@@ -1566,24 +2171,22 @@ std::vector<unsigned int> genSphereIndices()
 std::vector<float> genPyramidVerts(int sides, float height, float radius, color color)
 {
     std::vector<float> vertices;
-    vertices.reserve((sides + 1) * 9); // Each vertex has 9 components now (including alpha)
+    vertices.reserve(sides * 9 * 9); // Three triangles of 9 component vertices per side
 
-    float angleIncrement = 2 * PI / static_cast<float>(sides);
+    // Shared unit circle for this number of sides, entry i + 1 wraps around at i == sides - 1
+    const TrigRing& ring = TrigRingCache::get(sides);
 
     float r = color.redValue;
     float g = color.greenValue;
     float b = color.blueValue;
     float a = color.alphaValue;
 
-    // Vertex at the top of the pyramid/cone
-    float topVertex[] = { 0.0f, height / 2.0f, 0.0f, r, g, b, a, 0.5f, 1.0f }; // Center of the texture
-
     for (int i = 0; i < sides; ++i) {
         // Calculate the coordinates for the base of the pyramid/cone
-        float x1 = radius * cos(i * angleIncrement);
-        float z1 = radius * sin(i * angleIncrement);
-        float x2 = radius * cos((i + 1) * angleIncrement);
-        float z2 = radius * sin((i + 1) * angleIncrement);
+        float x1 = radius * ring.cosines[i];
+        float z1 = radius * ring.sines[i];
+        float x2 = radius * ring.cosines[i + 1];
+        float z2 = radius * ring.sines[i + 1];
 
         // Calculate the texture coordinates for the sides
         float u1 = static_cast<float>(i) / static_cast<float>(sides - 1); // Range [0, 1]
@@ -1622,14 +2225,14 @@ std::vector<float> genPyramidVerts(int sides, float height, float radius, color
 
     // Add vertices for the base
     for (int i = 0; i < sides; ++i) {
-        float x1 = radius * cos(i * angleIncrement);
-        float z1 = radius * sin(i * angleIncrement);
-        float x2 = radius * cos((i + 1) * angleIncrement);
-        float z2 = radius * sin((i + 1) * angleIncrement);
+        float x1 = radius * ring.cosines[i];
+        float z1 = radius * ring.sines[i];
+        float x2 = radius * ring.cosines[i + 1];
+        float z2 = radius * ring.sines[i + 1];
 
         // Calculate the texture coordinates for the base
-        float u1 = 0.5f + 0.5f * cos(i * angleIncrement);
-        float u2 = 0.5f + 0.5f * cos((i + 1) * angleIncrement);
+        float u1 = 0.5f + 0.5f * ring.cosines[i];
+        float u2 = 0.5f + 0.5f * ring.cosines[i + 1];
 
         // Add vertices for the base triangle with texture coordinates
         vertices.insert(vertices.end(), {
@@ -1650,44 +2253,45 @@ std::vector<float> genPyramidVerts(int sides, float height, float radius, color
     return vertices;
 }
 
-// Function to generate a pyramid's indices
-std::vector<unsigned int> genPyramidIndices(int sides)
+// Function to generate indices for a triangle soup (0, 1, 2, ...)
+std::vector<unsigned int> genSequentialIndices(unsigned int vertexCount)
 {
-    std::vector<unsigned int> indices;
-
-    // Connect the apex vertex to each base vertex
-    for (unsigned int i = 0; i < sides; ++i) {
-        indices.push_back(0);  // Apex vertex is 0
-        indices.push_back(2 + i);
-        indices.push_back(2 + (i +1) % sides);
-    }
-
-    // Connect base vertices to form the base
-    for (unsigned int i = 0; i < sides; ++i) {
-        indices.push_back(1);  // Center vertex of base is 1
-        indices.push_back(2 + i);
-        indices.push_back(2 + (i + 1) % sides);
-    }
+    std::vector<unsigned int> indices(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+        indices[i] = i;
 
     return indices;
 }
 
 bool progInitialize(GLFWwindow** window) {
+    if (contextBackend == BACKEND_EGL)
+        return progInitializeEGL();
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+    // the benchmark renders offscreen, so its window is never shown
+    if (benchMode)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     // glfw window creation
     // --------------------
+    // 4.3 for multi-draw indirect, the scene itself only needs 4.2
     *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "2DScene Recreation", NULL, NULL);
-    if (window == NULL)
+    if (*window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+        *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "2DScene Recreation", NULL, NULL);
+    }
+    if (*window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -1710,9 +2314,644 @@ bool progInitialize(GLFWwindow** window) {
         return false;
     }
 
+    // don't let vsync cap the benchmark
+    if (benchMode)
+        glfwSwapInterval(0);
+
     return true;
 }
 
+// Function to create the surfaceless EGL context
+// Everything after this point (meshes, textures, shaders) is the same as with GLFW
+bool progInitializeEGL() {
+#ifdef SCENE_HAS_EGL
+    // 4.3 for multi-draw indirect, the scene itself only needs 4.2
+    if (!headlessContext.create(4, 3) && !headlessContext.create(4, 2))
+        return false;
+
+    // glad: load the OpenGL function pointers through EGL
+    // ---------------------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        headlessContext.destroy();
+        return false;
+    }
+
+    return true;
+#else
+    std::cout << "The EGL backend is not available in this build" << std::endl;
+    return false;
+#endif
+}
+
+// Function to release the window or context
+void progTerminate() {
+#ifdef SCENE_HAS_EGL
+    if (contextBackend == BACKEND_EGL)
+    {
+        headlessContext.destroy();
+        return;
+    }
+#endif
+    glfwTerminate();
+}
+
+// Function to read the command line options
+// --bench [frames]     render frames offscreen and write frame time statistics
+// --bench-out <file>   where the statistics are written (bench_results.json)
+// --bench-capture <file.ppm>  also save the last benchmark frame as an image
+// --backend glfw|egl   context backend, egl is surfaceless and implies --bench
+// --microbench         time the mesh generators on the CPU and exit
+// --vertex-format float|packed  36 byte float vertices (default) or 16 byte packed ones, whose half
+//                      float positions and 8 bit colors are slightly lossy
+// --vertex-pulling     compute cylinders, spheres and cones in the vertex shader, no vertex buffer for them
+// --no-instancing      draw every copy of a mesh with its own draw call
+// --no-frustum-culling draw objects outside the view too
+// --no-multi-draw      one draw call per item even when OpenGL 4.3 multi-draw indirect is available
+// --no-texture-streaming  upload every texture before the first frame
+// --texture-budget KiB texel data streamed into textures per frame (4096)
+// --compress-textures  write a BC7 .dds file with every mip level next to each texture image and exit
+// --no-compressed-textures  decode the images even when their .dds files are up to date
+// --mip-filter box|kaiser  filter the texture mip levels are built with (box)
+// --mip-gamma          filter the mip levels in linear light instead of on the sRGB values
+// --props N            scatter N extra cat spheres over the plane
+// --worker-threads N   threads building meshes during startup, 0 builds them on the main thread
+// --no-vertex-weld     keep duplicate vertices inside meshes
+// --no-vertex-cache-order  upload triangles in the order the generators emit them
+// --lod auto|0-3       level of detail of the procedural meshes, auto picks it from the screen size (default)
+// --lod-sides a,b,c,d  sides of each level, generated at startup unless they are the compile-time 8,16,32,64
+bool parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bench") == 0)
+        {
+            benchMode = true;
+            // optional frame count
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                benchFrames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc)
+        {
+            benchOutput = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--microbench") == 0)
+        {
+            microbenchMode = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-capture") == 0 && i + 1 < argc)
+        {
+            benchCapture = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "float") == 0)
+                vertexFormat = VERTEX_FORMAT_FLOAT;
+            else if (std::strcmp(argv[i], "packed") == 0)
+                vertexFormat = VERTEX_FORMAT_PACKED;
+            else
+            {
+                std::cout << "Unknown vertex format: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--vertex-pulling") == 0)
+        {
+            vertexPulling = true;
+        }
+        else if (std::strcmp(argv[i], "--no-instancing") == 0)
+        {
+            instancing = false;
+        }
+        else if (std::strcmp(argv[i], "--no-frustum-culling") == 0)
+        {
+            frustumCulling = false;
+        }
+        else if (std::strcmp(argv[i], "--no-multi-draw") == 0)
+        {
+            multiDrawIndirect = false;
+        }
+        else if (std::strcmp(argv[i], "--no-texture-streaming") == 0)
+        {
+            textureStreaming = false;
+        }
+        else if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            int budget = std::atoi(argv[++i]);
+            if (budget <= 0)
+            {
+                std::cout << "Texture budget must be positive: " << argv[i] << std::endl;
+                return false;
+            }
+            textureBudgetBytes = static_cast<size_t>(budget) << 10;
+        }
+        else if (std::strcmp(argv[i], "--compress-textures") == 0)
+        {
+            compressTexturesMode = true;
+        }
+        else if (std::strcmp(argv[i], "--no-compressed-textures") == 0)
+        {
+            compressedTextures = false;
+        }
+        else if (std::strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "box") == 0)
+                mipFilter = MIP_FILTER_BOX;
+            else if (std::strcmp(argv[i], "kaiser") == 0)
+                mipFilter = MIP_FILTER_KAISER;
+            else
+            {
+                std::cout << "Unknown mip filter: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--mip-gamma") == 0)
+        {
+            mipGamma = true;
+        }
+        else if (std::strcmp(argv[i], "--props") == 0 && i + 1 < argc)
+        {
+            propCount = std::atoi(argv[++i]);
+            if (propCount < 0)
+            {
+                std::cout << "Prop count must not be negative: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--worker-threads") == 0 && i + 1 < argc)
+        {
+            workerThreads = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--no-vertex-weld") == 0)
+        {
+            vertexWeld = false;
+        }
+        else if (std::strcmp(argv[i], "--no-vertex-cache-order") == 0)
+        {
+            vertexCacheOrder = false;
+        }
+        else if (std::strcmp(argv[i], "--lod") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "auto") == 0)
+                forcedLod = -1;
+            else if (argv[i][0] >= '0' && argv[i][0] < '0' + LOD_COUNT && argv[i][1] == '\0')
+                forcedLod = argv[i][0] - '0';
+            else
+            {
+                std::cout << "Unknown level of detail: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--lod-sides") == 0 && i + 1 < argc)
+        {
+            ++i;
+            int parsed[LOD_COUNT];
+            if (std::sscanf(argv[i], "%d,%d,%d,%d", &parsed[0], &parsed[1], &parsed[2], &parsed[3]) != LOD_COUNT ||
+                *std::min_element(parsed, parsed + LOD_COUNT) < 3)
+            {
+                std::cout << "Expected " << LOD_COUNT << " comma separated side counts of at least 3: " << argv[i] << std::endl;
+                return false;
+            }
+            std::copy(parsed, parsed + LOD_COUNT, lodSides);
+        }
+        else if (std::strcmp(argv[i], "--mesh-cache") == 0 && i + 1 < argc)
+        {
+            meshCachePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-mesh-cache") == 0)
+        {
+            meshCachePath.clear();
+        }
+        else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "glfw") == 0)
+                contextBackend = BACKEND_GLFW;
+            else if (std::strcmp(argv[i], "egl") == 0)
+                contextBackend = BACKEND_EGL;
+            else
+            {
+                std::cout << "Unknown backend: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            return false;
+        }
+    }
+
+    // a surfaceless context has nothing to present to, so it can only run the benchmark
+    if (contextBackend == BACKEND_EGL && !benchMode)
+    {
+        std::cout << "The EGL backend has no window, running with --bench" << std::endl;
+        benchMode = true;
+    }
+
+    if (benchFrames <= 0)
+    {
+        std::cout << "Benchmark frame count must be positive" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Function to render the benchmark frames offscreen
+bool runBenchmark(Shader& ourShader)
+{
+    FrameBenchmark bench(SCR_WIDTH, SCR_HEIGHT, benchFrames);
+    if (!bench.create())
+        return false;
+    int totalFrames = bench.WarmupFrames + bench.FrameCount;
+    bench.setInfo("backend", contextBackend == BACKEND_EGL ? "egl" : "glfw");
+    bench.setInfo("vertex_format", vertexFormat == VERTEX_FORMAT_PACKED ? "packed" : "float");
+    bench.setInfo("vertex_buffer_bytes", std::to_string(meshes.vertexBufferBytes()));
+    bench.setInfo("mesh_source", meshSource);
+    bench.setInfo("mesh_setup_ms", std::to_string(meshSetupMs));
+    bench.setInfo("mesh_build_ms", std::to_string(meshBuildMs));
+    bench.setInfo("startup_ms", std::to_string(startupMs));
+    bench.setInfo("worker_threads", std::to_string(workers ? workers->threadCount() : 0));
+    bench.setInfo("lod", forcedLod < 0 ? "auto" : std::to_string(forcedLod));
+    bench.setInfo("vertex_pulling", vertexPulling ? "on" : "off");
+    bench.setInfo("instancing", instancing ? "on" : "off");
+    bench.setInfo("props", std::to_string(propCount));
+    bench.setInfo("frustum_culling", frustumCulling ? "on" : "off");
+    bench.setInfo("multi_draw_indirect", multiDrawIndirect ? "on" : "off");
+    bench.setInfo("texture_streaming", textureStreaming ? "on" : "off");
+    bench.setInfo("texture_budget_bytes", std::to_string(textureBudgetBytes));
+    bench.setInfo("texture_format", materialArray.isCompressed() ? "bc7" : "rgba8");
+    bench.setInfo("texture_bytes", std::to_string(materialArray.byteCount()));
+    bench.setInfo("mip_filter", mipFilter == MIP_FILTER_KAISER ? "kaiser" : "box");
+    bench.setInfo("mip_gamma", mipGamma ? "on" : "off");
+
+    // processInput normally keeps the projection up to date
+    isPerspective = true;
+
+    // every texture is decoded before timing starts, so the frames show the budgeted uploads
+    // rather than how long the decodes take
+    DecodedTexture texture;
+    while (takeDecodedTexture(texture, true))
+        uploadTexture(texture);
+
+    while (!bench.finished())
+    {
+        setBenchCamera(bench.currentFrame(), totalFrames);
+        toggleView();
+
+        bench.beginFrame();
+        renderScene(ourShader);
+        bench.endFrame(frameCounters);
+    }
+
+    if (!benchCapture.empty())
+        bench.captureFrame(benchCapture);
+    // written after the frames, streaming finishes during them
+    bench.setInfo("texture_setup_ms", texturesFinished ? std::to_string(textureSetupMs) : "unfinished");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    bench.printSummary();
+    return bench.writeResults(benchOutput);
+}
+
+// Function to time the mesh generators without a GL context
+// Builds the same cylinder/cap/cone meshes createMesh does at several tessellations. "cold" empties
+// the trig cache before every generator call, which is what the generators cost when each one
+// computed its own cos/sin; "warm" reuses the shared ring like a real startup does.
+// Then times the sphere kernels against the per-vertex scalar loop and checks they agree.
+bool runGeometryMicrobench()
+{
+    const int resolutions[] = { 20, 256, 4096, 16384 };
+    const int repetitions = 50;
+    const color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // builds one scene's worth of ring-based geometry, returns the float count so nothing is optimized out
+    auto buildAll = [&white](int n, bool cold) {
+        size_t total = 0;
+        for (int shape = 0; shape < 9; ++shape)
+        {
+            if (cold)
+                TrigRingCache::clear();
+            switch (shape % 4)
+            {
+            case 0: total += genCylSideVerts(n, 0.35f, 0.2375f, white).size(); break;
+            case 1: total += genCylTopVerts(n, 0.35f, 0.2375f, white).size(); break;
+            case 2: total += genCylBottomVerts(n, 0.35f, 0.2375f, white).size(); break;
+            case 3: total += genPyramidVerts(n, 0.5f, 0.25f, white).size(); break;
+            }
+        }
+        return total;
+    };
+
+    std::cout << "sides\tcold (ms)\twarm (ms)\tspeedup" << std::endl;
+    for (int n : resolutions)
+    {
+        size_t checksum = 0;
+
+        double coldMs = microbenchMs(repetitions, [&] { checksum += buildAll(n, true); });
+        double warmMs = microbenchMs(repetitions, [&] { checksum += buildAll(n, false); });
+
+        std::cout << n << "\t" << coldMs << "\t" << warmMs << "\t" << coldMs / warmMs << "x"
+                  << (checksum == 0 ? " (empty)" : "") << std::endl;
+    }
+
+    // close-up spheres, rings == segments
+    const int sphereResolutions[] = { 20, 256, 1024, 2048 };
+    const float rgba[] = { white.redValue, white.greenValue, white.blueValue, white.alphaValue };
+
+    std::cout << std::endl << "rings\tscalar (ms)\t" << vectorColumn(meshKernelsVectorized()) << " (ms)\tspeedup" << std::endl;
+    for (int n : sphereResolutions)
+    {
+        std::vector<float> out(sphereFloatCount(n, n));
+        int sphereRepetitions = n >= 1024 ? 5 : repetitions;
+
+        double scalarMs = microbenchMs(sphereRepetitions, [&] { writeSphereVerticesScalar(out.data(), n, n, static_cast<float>(PI), 0.5625f, rgba); });
+        double vectorMs = microbenchMs(sphereRepetitions, [&] { writeSphereVertices(out.data(), n, n, static_cast<float>(PI), 0.5625f, rgba); });
+
+        std::cout << n << "\t" << scalarMs << "\t" << vectorMs << "\t" << scalarMs / vectorMs << "x" << std::endl;
+    }
+
+    // whole scene generated, welded and reordered, on the main thread and on the workers
+    if (workers)
+    {
+        const int chains[][LOD_COUNT] = { { 8, 16, 32, 64 }, { 64, 128, 256, 512 } };
+        int savedSides[LOD_COUNT];
+        std::copy(lodSides, lodSides + LOD_COUNT, savedSides);
+
+        auto timeSceneBuild = [&]() {
+            double best = 1e30;
+            for (int r = 0; r < 5; ++r)
+            {
+                auto start = std::chrono::steady_clock::now();
+                MeshRegistry registry;
+                addGeneratedMeshes(registry);
+                registry.weldVertices(MESH_WELD_TOLERANCE, WorkerForEach());
+                registry.optimizeVertexCache(VERTEX_CACHE_SIZE, WorkerForEach());
+                best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            return best;
+        };
+
+        std::cout << std::endl << "lod sides\t1 thread (ms)\t" << workers->threadCount() << " threads (ms)\tspeedup" << std::endl;
+        for (const auto& chain : chains)
+        {
+            std::copy(chain, chain + LOD_COUNT, lodSides);
+            std::unique_ptr<ThreadPool> pool = std::move(workers);
+            double serialMs = timeSceneBuild();
+            workers = std::move(pool);
+            double parallelMs = timeSceneBuild();
+            std::cout << chain[0] << ".." << chain[LOD_COUNT - 1] << "\t" << serialMs << "\t" << parallelMs << "\t" << serialMs / parallelMs << "x" << std::endl;
+        }
+        std::copy(savedSides, savedSides + LOD_COUNT, lodSides);
+    }
+
+    std::cout << std::endl;
+    bool kernelsPassed = checkMeshKernels();
+    bool staticPassed = checkStaticMeshes();
+    std::cout << std::endl;
+    bool weldPassed = checkVertexWelding();
+    std::cout << std::endl;
+    bool orderPassed = checkVertexCacheOrder();
+    std::cout << std::endl;
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f) *
+        Camera(glm::vec3(0.0f, 0.0f, 3.0f)).GetViewMatrix();
+    bool cullingPassed = checkFrustumCulling(viewProjection, meshBounds[MESH_CUBE], meshBounds[MESH_SPHERE]);
+    std::cout << std::endl;
+    bool compressionPassed = checkTextureCompression();
+    std::cout << std::endl;
+    bool mipsPassed = checkMipChains(MATERIAL_TEXTURE_SIZE);
+    return kernelsPassed && staticPassed && weldPassed && orderPassed && cullingPassed && compressionPassed && mipsPassed;
+}
+
+// Function to report how many vertices welding removes from every mesh
+// Works on the CPU copy of the default scene, every corner of every triangle must keep its attributes
+bool checkVertexWelding()
+{
+    MeshRegistry original;
+    addStaticMeshes(original);
+    MeshRegistry welded;
+    addStaticMeshes(welded);
+    welded.weldVertices();
+
+    bool passed = true;
+    size_t totalBefore = 0, totalAfter = 0;
+    std::cout << "vertex welding (tolerance " << MESH_WELD_TOLERANCE << ")" << std::endl;
+    std::cout << "mesh\tlevel\tvertices before\tvertices after" << std::endl;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        int levels = PROCEDURAL_MESHES[mesh].shape == SHAPE_NONE ? 1 : LOD_COUNT;
+        for (int level = 0; level < levels; ++level)
+        {
+            int entry = registryMesh(static_cast<MeshId>(mesh), level);
+            size_t before = original.vertexCount(entry);
+            size_t after = welded.vertexCount(entry);
+            totalBefore += before;
+            totalAfter += after;
+            if (after != before)
+                std::cout << MESH_NAMES[mesh] << "\t" << level << "\t" << before << "\t" << after << std::endl;
+
+            // welding keeps the triangle order, so corners compare one to one
+            const MeshRange& originalRange = original.range(entry);
+            const MeshRange& weldedRange = welded.range(entry);
+            bool same = originalRange.indexCount == weldedRange.indexCount;
+            for (unsigned int i = 0; same && i < originalRange.indexCount; ++i)
+            {
+                const float* a = original.meshVertices(entry) + original.indices()[originalRange.firstIndex + i] * MeshRegistry::FLOATS_PER_VERTEX;
+                const float* b = welded.meshVertices(entry) + welded.indices()[weldedRange.firstIndex + i] * MeshRegistry::FLOATS_PER_VERTEX;
+                for (int f = 0; f < MeshRegistry::FLOATS_PER_VERTEX; ++f)
+                    same &= std::fabs(a[f] - b[f]) <= MESH_WELD_TOLERANCE;
+            }
+            if (!same)
+            {
+                std::cout << "ERROR::MICROBENCH::WELD_CHANGED_MESH: " << MESH_NAMES[mesh] << " level " << level << std::endl;
+                passed = false;
+            }
+        }
+    }
+    std::cout << "all\t-\t" << totalBefore << "\t" << totalAfter << " (" << totalBefore * sizeof(PackedVertex) << " -> "
+              << totalAfter * sizeof(PackedVertex) << " packed bytes)" << std::endl;
+
+    return reportCheck("vertex weld", passed);
+}
+
+// Function to report the vertex cache use of every mesh before and after reordering
+// Works on the welded CPU copy of the default scene, the reordered meshes must keep every triangle and its winding
+bool checkVertexCacheOrder()
+{
+    MeshRegistry original;
+    addStaticMeshes(original);
+    original.weldVertices();
+    MeshRegistry reordered;
+    addStaticMeshes(reordered);
+    reordered.weldVertices();
+    reordered.optimizeVertexCache();
+
+    // triangles as a sorted list, each one rotated to start at its smallest index so winding still counts
+    auto triangleSet = [](const MeshRegistry& registry, int entry) {
+        const MeshRange& range = registry.range(entry);
+        const unsigned int* indices = registry.indices().data() + range.firstIndex;
+        std::vector<std::array<unsigned int, 3>> triangles;
+        for (unsigned int i = 0; i + 2 < range.indexCount; i += 3)
+        {
+            std::array<unsigned int, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+
+    bool passed = true;
+    VertexCacheStats totalBefore, totalAfter;
+    std::cout << "vertex cache (FIFO " << VERTEX_CACHE_SIZE << ")" << std::endl;
+    std::cout << "mesh\tlevel\ttriangles\tACMR before\tACMR after\tATVR before\tATVR after" << std::endl;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        int levels = PROCEDURAL_MESHES[mesh].shape == SHAPE_NONE ? 1 : LOD_COUNT;
+        for (int level = 0; level < levels; ++level)
+        {
+            int entry = registryMesh(static_cast<MeshId>(mesh), level);
+            VertexCacheStats before = original.vertexCacheStats(entry);
+            VertexCacheStats after = reordered.vertexCacheStats(entry);
+            std::cout << MESH_NAMES[mesh] << "\t" << level << "\t" << before.triangles << "\t" << before.acmr() << "\t" << after.acmr()
+                      << "\t" << before.atvr() << "\t" << after.atvr() << std::endl;
+
+            if (triangleSet(original, entry) != triangleSet(reordered, entry))
+            {
+                std::cout << "ERROR::MICROBENCH::TRIANGLES_CHANGED: " << MESH_NAMES[mesh] << " level " << level << std::endl;
+                passed = false;
+            }
+            totalBefore.triangles += before.triangles;
+            totalBefore.vertices += before.vertices;
+            totalBefore.transforms += before.transforms;
+            totalAfter.triangles += after.triangles;
+            totalAfter.vertices += after.vertices;
+            totalAfter.transforms += after.transforms;
+        }
+    }
+    std::cout << "all\t-\t" << totalBefore.triangles << "\t" << totalBefore.acmr() << "\t" << totalAfter.acmr()
+              << "\t" << totalBefore.atvr() << "\t" << totalAfter.atvr() << std::endl;
+
+    return reportCheck("vertex cache order", passed);
+}
+
+// Function to compare the vector vertex kernels against their scalar versions
+bool checkMeshKernels()
+{
+    const float rgba[] = { glassColor.redValue, glassColor.greenValue, glassColor.blueValue, glassColor.alphaValue };
+    const float radius = 0.5625f;
+    float worstError = 0.0f;
+    bool passed = true;
+
+    for (int n : { 3, 4, 7, 20, 64, 255, 1024 })
+    {
+        std::vector<float> expected(sphereFloatCount(n, n + 1));
+        std::vector<float> actual(expected.size());
+        writeSphereVerticesScalar(expected.data(), n, n + 1, static_cast<float>(PI), radius, rgba);
+        writeSphereVertices(actual.data(), n, n + 1, static_cast<float>(PI), radius, rgba);
+        passed &= compareMeshVertices("sphere", expected.data(), actual.data(), expected.size(), radius, worstError);
+
+        // reference ring with the C library's sin/cos against the (possibly vectorized) ring
+        float step = 2.0f * 3.14159265358979323846f / n;
+        std::vector<float> cosines(n + 1), sines(n + 1), fastCosines(n + 1), fastSines(n + 1);
+        sinCosStepsScalar(step, n + 1, sines.data(), cosines.data());
+        sinCosSteps(step, n + 1, fastSines.data(), fastCosines.data());
+
+        std::vector<float> expectedRow(n * 9), actualRow(n * 9);
+        writeCylinderRowScalar(expectedRow.data(), n, 0.5f, 1.0f, radius, rgba, cosines.data(), sines.data());
+        writeCylinderRow(actualRow.data(), n, 0.5f, 1.0f, radius, rgba, fastCosines.data(), fastSines.data());
+        passed &= compareMeshVertices("cylinder", expectedRow.data(), actualRow.data(), expectedRow.size(), radius, worstError);
+
+        // cap texture coordinates come straight from the ring, so compare them against the same ring
+        writeCapRowScalar(expectedRow.data(), n, 0.5f, radius, rgba, fastCosines.data(), fastSines.data());
+        writeCapRow(actualRow.data(), n, 0.5f, radius, rgba, fastCosines.data(), fastSines.data());
+        passed &= compareMeshVertices("cap", expectedRow.data(), actualRow.data(), expectedRow.size(), radius, worstError);
+    }
+
+    std::cout << "kernel check: " << (passed ? "passed" : "FAILED") << ", worst position error " << worstError
+              << " x radius (tolerance " << MESH_KERNEL_TOLERANCE << ")" << std::endl;
+    return passed;
+}
+
+// Function to compare the runtime generators against the compile-time meshes
+// The compile-time tables use correctly rounded sin/cos, so they are the reference here
+bool checkStaticMeshes()
+{
+    float worstError = 0.0f;
+    bool passed = true;
+
+    // compares every level of one procedural mesh with its tables
+    auto check = [&](MeshId mesh, const char* name, int level, const auto& table, const auto& tableIndices) {
+        std::vector<float> generated = genLodVerts(mesh, STATIC_LOD_SIDES[level]);
+        if (generated.size() != table.size())
+        {
+            std::cout << "ERROR::MICROBENCH::STATIC_MESH_SIZE: " << name << " level " << level << " "
+                      << generated.size() << " != " << table.size() << std::endl;
+            passed = false;
+            return;
+        }
+        passed &= compareMeshVertices(name, table.data(), generated.data(), table.size(), PROCEDURAL_MESHES[mesh].radius, worstError);
+        // indices have no rounding at all
+        passed &= genLodIndices(mesh, STATIC_LOD_SIDES[level]) == std::vector<unsigned int>(tableIndices.begin(), tableIndices.end());
+    };
+
+    forEachStaticLod<MESH_CYL1_SIDE>([&](int level, const auto& v, const auto& i) { check(MESH_CYL1_SIDE, "cylinder side", level, v, i); });
+    forEachStaticLod<MESH_CYL1_TOP>([&](int level, const auto& v, const auto& i) { check(MESH_CYL1_TOP, "cylinder top", level, v, i); });
+    forEachStaticLod<MESH_CYL1_BOTTOM>([&](int level, const auto& v, const auto& i) { check(MESH_CYL1_BOTTOM, "cylinder bottom", level, v, i); });
+    forEachStaticLod<MESH_SPHERE>([&](int level, const auto& v, const auto& i) { check(MESH_SPHERE, "sphere", level, v, i); });
+    forEachStaticLod<MESH_CONE>([&](int level, const auto& v, const auto& i) { check(MESH_CONE, "cone", level, v, i); });
+
+    std::cout << "static mesh check: " << (passed ? "passed" : "FAILED") << ", worst position error " << worstError
+              << " x radius (tolerance " << MESH_KERNEL_TOLERANCE << ")" << std::endl;
+    return passed;
+}
+
+// Function to compare two vertex buffers
+// Positions may differ by MESH_KERNEL_TOLERANCE x radius and texture coordinates (derived from the same
+// sin/cos on caps and cones) by MESH_KERNEL_TOLERANCE, colors must match exactly
+bool compareMeshVertices(const char* name, const float* expected, const float* actual, size_t floatCount, float radius, float& worstError)
+{
+    for (size_t i = 0; i < floatCount; ++i)
+    {
+        int component = static_cast<int>(i % MeshRegistry::FLOATS_PER_VERTEX);
+        bool isPosition = component < 3;
+        bool isColor = component >= 3 && component < 7;
+        float error = std::fabs(expected[i] - actual[i]);
+        if (isPosition)
+            worstError = std::max(worstError, error / radius);
+        float tolerance = isColor ? 0.0f : (isPosition ? MESH_KERNEL_TOLERANCE * radius : MESH_KERNEL_TOLERANCE);
+        if (error > tolerance)
+        {
+            std::cout << "ERROR::MICROBENCH::MESH_MISMATCH: " << name << " float " << i
+                      << " expected " << expected[i] << " got " << actual[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to place the camera for a benchmark frame
+// Orbits the table once over the run so every object is seen from every side
+void setBenchCamera(int frame, int frameCount)
+{
+    glm::vec3 target(-0.5f, -0.6f, 0.0f);
+    float orbitRadius = 3.5f;
+    float angle = 2.0f * PI * frame / frameCount;
+
+    glm::vec3 position = target + glm::vec3(orbitRadius * sin(angle), 1.0f, orbitRadius * cos(angle));
+    glm::vec3 toTarget = glm::normalize(target - position);
+
+    float yaw = glm::degrees(atan2(toTarget.z, toTarget.x));
+    float pitch = glm::degrees(asin(toTarget.y));
+    camera = Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), yaw, pitch);
+}
+
 // Function to generate a random r/g/b value
 float genColorValue() {
     return (float) rand()/RAND_MAX;
@@ -1737,21 +2976,21 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)	// When pressing E
         camera.ProcessKeyboard(DOWN, deltaTime);			// move down
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)	// When P is pressed
-        isPerspective = !isPerspective;                     // toggle orthographic and 
-        toggleView();                                       // perspective views
+        isPerspective = !isPerspective;                     // toggle orthographic and perspective views
+    toggleView();                                           // keep the projection in step with the view and zoom
 }
 
 // Function for toggling view between orthograpic and persepctive
 void toggleView() {
     if (isPerspective)
     {
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
     }
     else
     {
         float orthoWidth = 1.0f; 
         float aspectRatio = (float)SCR_WIDTH / (float)SCR_HEIGHT;
-        projection = glm::ortho(-orthoWidth * aspectRatio, orthoWidth * aspectRatio, -orthoWidth, orthoWidth, 0.0001f, 100.0f);
+        projection = glm::ortho(-orthoWidth * aspectRatio, orthoWidth * aspectRatio, -orthoWidth, orthoWidth, 0.0001f, FAR_PLANE);
     }
 }
 
@@ -1763,6 +3002,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    viewportHeight = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
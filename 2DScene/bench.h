@@ -0,0 +1,306 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-frame counters filled in by the render loop
+struct FrameCounters
+{
+    unsigned int drawCalls = 0;
+    unsigned int triangles = 0;
+    unsigned int visibleObjects = 0;    // objects and instances that passed frustum culling
+    unsigned int culledObjects = 0;     // objects and instances skipped by it
+    unsigned int stateChanges = 0;      // program, texture and vertex array binds
+    unsigned int textureUploadBytes = 0;    // texels streamed into textures
+};
+
+// Renders a fixed number of frames into an offscreen framebuffer and records CPU/GPU frame times
+class FrameBenchmark
+{
+public:
+    // framebuffer and timer objects
+    unsigned int FBO;
+    unsigned int colorRBO;
+    unsigned int depthRBO;
+    // benchmark options
+    int Width;
+    int Height;
+    int FrameCount;
+    int WarmupFrames;
+
+    // constructor only records the options, create() makes the GL objects
+    // ------------------------------------------------------------------------
+    FrameBenchmark(int width, int height, int frameCount, int warmupFrames = 10)
+        : FBO(0), colorRBO(0), depthRBO(0), Width(width), Height(height), FrameCount(frameCount), WarmupFrames(warmupFrames),
+          queries(), frame(0)
+    {
+    }
+
+    // creates the offscreen target and the timer queries, it needs a current GL context. Returns false
+    // when the framebuffer is incomplete, frames rendered into it would be timed but draw nothing
+    // ------------------------------------------------------------------------
+    bool create()
+    {
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        glGenRenderbuffers(1, &colorRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete)
+        {
+            std::cout << "ERROR::BENCH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            return false;
+        }
+
+        // GPU timer queries are read back a few frames late so the CPU never waits on them
+        glGenQueries(QUERY_LATENCY, queries);
+        for (int i = 0; i < QUERY_LATENCY; ++i)
+            queryFrame[i] = -1;
+        return true;
+    }
+
+    ~FrameBenchmark()
+    {
+        glDeleteQueries(QUERY_LATENCY, queries);
+        glDeleteRenderbuffers(1, &colorRBO);
+        glDeleteRenderbuffers(1, &depthRBO);
+        glDeleteFramebuffers(1, &FBO);
+    }
+
+    // true once every warmup and measured frame has been rendered
+    bool finished() const
+    {
+        return frame >= WarmupFrames + FrameCount;
+    }
+
+    // index of the frame about to be rendered, warmup frames included
+    int currentFrame() const
+    {
+        return frame;
+    }
+
+    // binds the offscreen target and starts the timers for one frame
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, Width, Height);
+
+        int slot = frame % QUERY_LATENCY;
+        if (queryFrame[slot] >= 0)
+            collectQuery(slot);
+        queryFrame[slot] = frame;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+
+        cpuStart = std::chrono::steady_clock::now();
+    }
+
+    // stops the timers and stores this frame's results
+    // ------------------------------------------------------------------------
+    void endFrame(const FrameCounters& counters)
+    {
+        double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        if (frame >= WarmupFrames)
+        {
+            cpuTimes.push_back(cpuMs);
+            frameCounters.push_back(counters);
+        }
+        ++frame;
+
+        // make sure every outstanding query lands before results are written
+        if (finished())
+        {
+            glFinish();
+            for (int i = 0; i < QUERY_LATENCY; ++i)
+                if (queryFrame[i] >= 0)
+                    collectQuery(i);
+        }
+    }
+
+    // adds a key/value pair describing the run to the results file
+    void setInfo(const std::string& key, const std::string& value)
+    {
+        info.push_back(std::make_pair(key, value));
+    }
+
+    // writes the frame time percentiles and counters as JSON
+    // ------------------------------------------------------------------------
+    bool writeResults(const std::string& path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCH::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+        out << "{\n";
+        out << "  \"renderer\": " << jsonString(renderer ? renderer : "unknown") << ",\n";
+        out << "  \"gl_version\": " << jsonString(version ? version : "unknown") << ",\n";
+        out << "  \"width\": " << Width << ",\n";
+        out << "  \"height\": " << Height << ",\n";
+        out << "  \"frames\": " << cpuTimes.size() << ",\n";
+        out << "  \"warmup_frames\": " << WarmupFrames << ",\n";
+        for (const auto& entry : info)
+            out << "  " << jsonString(entry.first) << ": " << jsonString(entry.second) << ",\n";
+        writePercentiles(out, "cpu_frame_ms", cpuTimes);
+        out << ",\n";
+        writePercentiles(out, "gpu_frame_ms", gpuTimes);
+        out << ",\n";
+        writeCounter(out, "draw_calls", [](const FrameCounters& c) { return c.drawCalls; });
+        out << ",\n";
+        writeCounter(out, "triangles", [](const FrameCounters& c) { return c.triangles; });
+        out << ",\n";
+        writeCounter(out, "visible_objects", [](const FrameCounters& c) { return c.visibleObjects; });
+        out << ",\n";
+        writeCounter(out, "culled_objects", [](const FrameCounters& c) { return c.culledObjects; });
+        out << ",\n";
+        writeCounter(out, "state_changes", [](const FrameCounters& c) { return c.stateChanges; });
+        out << ",\n";
+        writeCounter(out, "texture_upload_bytes", [](const FrameCounters& c) { return c.textureUploadBytes; });
+        out << "\n}\n";
+        return true;
+    }
+
+    // writes the last rendered frame as a binary PPM so headless runs can be inspected
+    // ------------------------------------------------------------------------
+    bool captureFrame(const std::string& path) const
+    {
+        std::vector<unsigned char> pixels(static_cast<size_t>(Width) * Height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCH::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        out << "P6\n" << Width << " " << Height << "\n255\n";
+        // OpenGL rows start at the bottom
+        for (int y = Height - 1; y >= 0; --y)
+            out.write(reinterpret_cast<const char*>(&pixels[static_cast<size_t>(y) * Width * 3]), Width * 3);
+        return true;
+    }
+
+    // prints a one line summary to the console
+    void printSummary() const
+    {
+        std::vector<double> cpu = cpuTimes;
+        std::vector<double> gpu = gpuTimes;
+        std::cout << "bench: " << cpu.size() << " frames, cpu p50 " << percentile(cpu, 50.0) << " ms p99 " << percentile(cpu, 99.0)
+                  << " ms, gpu p50 " << percentile(gpu, 50.0) << " ms p99 " << percentile(gpu, 99.0) << " ms" << std::endl;
+    }
+
+private:
+    static const int QUERY_LATENCY = 4;
+    unsigned int queries[QUERY_LATENCY];
+    int queryFrame[QUERY_LATENCY];
+    int frame;
+    std::chrono::steady_clock::time_point cpuStart;
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    std::vector<FrameCounters> frameCounters;
+    std::vector<std::pair<std::string, std::string>> info;
+
+    // reads back a finished timer query, blocking if the GPU is still behind
+    void collectQuery(int slot)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+        if (queryFrame[slot] >= WarmupFrames)
+            gpuTimes.push_back(elapsed / 1.0e6);
+        queryFrame[slot] = -1;
+    }
+
+    // quotes a string for JSON, escaping quotes, backslashes and control characters
+    static std::string jsonString(const std::string& value)
+    {
+        std::string quoted = "\"";
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+                quoted += escaped;
+            }
+            else
+                quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // nearest-rank percentile (the ceil(p/100 * n)-th smallest value), sorts the values in place
+    static double percentile(std::vector<double>& values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        rank = std::min(std::max(rank, static_cast<size_t>(1)), values.size());
+        return values[rank - 1];
+    }
+
+    static void writePercentiles(std::ofstream& out, const char* name, std::vector<double> values)
+    {
+        double mean = 0.0;
+        for (double v : values)
+            mean += v;
+        if (!values.empty())
+            mean /= values.size();
+
+        out << "  \"" << name << "\": { \"p50\": " << percentile(values, 50.0) << ", \"p95\": " << percentile(values, 95.0)
+            << ", \"p99\": " << percentile(values, 99.0) << ", \"max\": " << percentile(values, 100.0) << ", \"mean\": " << mean << " }";
+    }
+
+    template <typename Getter>
+    void writeCounter(std::ofstream& out, const char* name, Getter get) const
+    {
+        double mean = 0.0;
+        unsigned int max = 0;
+        for (const FrameCounters& c : frameCounters)
+        {
+            mean += get(c);
+            max = std::max(max, static_cast<unsigned int>(get(c)));
+        }
+        if (!frameCounters.empty())
+            mean /= frameCounters.size();
+
+        out << "  \"" << name << "\": { \"mean\": " << mean << ", \"max\": " << max << " }";
+    }
+};
+#endif
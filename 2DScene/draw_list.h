@@ -0,0 +1,98 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Draw items and their sort key. A frame's draws are queued first, then sorted by a 64 bit key that
+// puts the most expensive state in the highest bits and submitted in that order, so draws that share
+// a program, texture and vertex array run back to back and each state is set once per run.
+
+// Sort key fields, highest bits first. Depth orders draws with the same state front to back so
+// early depth testing rejects more of the later ones.
+const int SORT_KEY_PROGRAM_BITS = 8;
+const int SORT_KEY_TEXTURE_BITS = 16;
+const int SORT_KEY_VERTEX_ARRAY_BITS = 8;
+const int SORT_KEY_MESH_BITS = 16;
+const int SORT_KEY_DEPTH_BITS = 16;
+
+// packs the fields into a key, depth is 0 at the camera and 1 at the far plane
+// ------------------------------------------------------------------------
+inline std::uint64_t makeSortKey(unsigned int program, unsigned int texture, unsigned int vertexArray, unsigned int mesh, float depth)
+{
+    auto field = [](std::uint64_t value, int bits) { return value & ((std::uint64_t(1) << bits) - 1); };
+    std::uint64_t quantizedDepth = static_cast<std::uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * ((1 << SORT_KEY_DEPTH_BITS) - 1));
+
+    std::uint64_t key = field(program, SORT_KEY_PROGRAM_BITS);
+    key = (key << SORT_KEY_TEXTURE_BITS) | field(texture, SORT_KEY_TEXTURE_BITS);
+    key = (key << SORT_KEY_VERTEX_ARRAY_BITS) | field(vertexArray, SORT_KEY_VERTEX_ARRAY_BITS);
+    key = (key << SORT_KEY_MESH_BITS) | field(mesh, SORT_KEY_MESH_BITS);
+    key = (key << SORT_KEY_DEPTH_BITS) | quantizedDepth;
+    return key;
+}
+
+// One draw: what to bind, what to draw and where
+struct DrawItem
+{
+    std::uint64_t key;
+    unsigned int program;        // GL program
+    unsigned int texture;        // GL texture array the draw's material layers are in
+    unsigned int vertexArray;    // GL vertex array
+    int mesh;                    // scene mesh id
+    int level;                   // registry level of detail, or side count of a pulled mesh
+    unsigned int baseInstance;   // first transform and material in the frame's instance data
+    unsigned int instanceCount;  // 1 for a single draw
+};
+
+// The draws of one frame
+class DrawList
+{
+public:
+    // forgets last frame's items
+    void clear()
+    {
+        drawItems.clear();
+        programs.clear();
+        textures.clear();
+        vertexArrays.clear();
+    }
+
+    // queues an item, the key is built from its state; depth is 0 at the camera and 1 at the far plane
+    // ------------------------------------------------------------------------
+    void add(DrawItem item, unsigned int meshKey, float depth)
+    {
+        // programs, textures and vertex arrays are numbered in order of first use, GL names can be large
+        item.key = makeSortKey(intern(programs, item.program), intern(textures, item.texture), intern(vertexArrays, item.vertexArray), meshKey, depth);
+        drawItems.push_back(item);
+    }
+
+    // orders the items by key, equal keys keep the order they were queued in
+    void sort()
+    {
+        std::stable_sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+    }
+
+    const std::vector<DrawItem>& items() const
+    {
+        return drawItems;
+    }
+
+private:
+    std::vector<DrawItem> drawItems;
+    std::vector<unsigned int> programs;
+    std::vector<unsigned int> textures;
+    std::vector<unsigned int> vertexArrays;
+
+    // a frame has a handful of distinct values, a linear search beats hashing
+    template <typename T>
+    static unsigned int intern(std::vector<T>& values, const T& value)
+    {
+        auto found = std::find(values.begin(), values.end(), value);
+        if (found != values.end())
+            return static_cast<unsigned int>(found - values.begin());
+        values.push_back(value);
+        return static_cast<unsigned int>(values.size() - 1);
+    }
+};
+#endif
@@ -0,0 +1,141 @@
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+// Headless OpenGL context for Linux render nodes (link with -lEGL).
+// Other platforms only get the GLFW window backend.
+#if defined(__linux__)
+#define SCENE_HAS_EGL 1
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+// Creates a desktop OpenGL core context with no window or surface through Mesa's
+// surfaceless platform, so it runs without X/Wayland and on llvmpipe. Nothing is
+// presented; all rendering has to go into a framebuffer object.
+class HeadlessContext
+{
+public:
+    EGLDisplay Display;
+    EGLContext Context;
+
+    HeadlessContext() : Display(EGL_NO_DISPLAY), Context(EGL_NO_CONTEXT)
+    {
+    }
+
+    // creates the context and makes it current on the calling thread
+    // ------------------------------------------------------------------------
+    bool create(int majorVersion, int minorVersion)
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (!getPlatformDisplay || !hasExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+        {
+            std::cout << "ERROR::EGL::SURFACELESS_PLATFORM_NOT_SUPPORTED" << std::endl;
+            return false;
+        }
+
+        Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        EGLint eglMajor, eglMinor;
+        if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &eglMajor, &eglMinor))
+        {
+            std::cout << "ERROR::EGL::INITIALIZE_FAILED: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+
+        if (!hasExtension(Display, "EGL_KHR_surfaceless_context") || !hasExtension(Display, "EGL_KHR_create_context"))
+        {
+            std::cout << "ERROR::EGL::SURFACELESS_CONTEXT_NOT_SUPPORTED" << std::endl;
+            destroy();
+            return false;
+        }
+
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(Display, configAttribs, &config, 1, &configCount) || configCount == 0)
+        {
+            std::cout << "ERROR::EGL::NO_MATCHING_CONFIG" << std::endl;
+            destroy();
+            return false;
+        }
+
+        // same version and profile the GLFW window asks for
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+            EGL_CONTEXT_MINOR_VERSION, minorVersion,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        Context = eglCreateContext(Display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (Context == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::EGL::CONTEXT_CREATION_FAILED: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            destroy();
+            return false;
+        }
+
+        if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context))
+        {
+            std::cout << "ERROR::EGL::MAKE_CURRENT_FAILED: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            destroy();
+            return false;
+        }
+
+        return true;
+    }
+
+    // releases the context and the display connection
+    // ------------------------------------------------------------------------
+    void destroy()
+    {
+        if (Display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (Context != EGL_NO_CONTEXT)
+            eglDestroyContext(Display, Context);
+        eglTerminate(Display);
+        Context = EGL_NO_CONTEXT;
+        Display = EGL_NO_DISPLAY;
+    }
+
+    // GL entry points have to come from EGL for this context, not from GLFW
+    static void* getProcAddress(const char* name)
+    {
+        return (void*)eglGetProcAddress(name);
+    }
+
+private:
+    // checks a display's (or the client's, for EGL_NO_DISPLAY) extension string
+    static bool hasExtension(EGLDisplay display, const char* name)
+    {
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!extensions)
+            return false;
+
+        size_t length = std::strlen(name);
+        for (const char* found = std::strstr(extensions, name); found; found = std::strstr(found + length, name))
+        {
+            bool startsWord = found == extensions || found[-1] == ' ';
+            bool endsWord = found[length] == ' ' || found[length] == '\0';
+            if (startsWord && endsWord)
+                return true;
+        }
+        return false;
+    }
+};
+
+#endif
+#endif
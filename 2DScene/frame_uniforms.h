@@ -0,0 +1,66 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Camera and light data shared by every draw of a frame. It lives in one uniform buffer bound to a
+// fixed binding point, shaders declare the FrameData block with the same binding and read it
+// without any per-program uniform calls.
+
+// Binding point of the FrameData block, the same number is in the shaders' layout qualifiers
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+
+// FrameData in std140 layout: mat4s are four vec4 columns, vec3s are padded to a vec4
+struct FrameUniformData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+};
+static_assert(sizeof(FrameUniformData) == 160, "FrameUniformData must match the std140 layout of FrameData");
+
+// The uniform buffer, written once per frame
+class FrameUniformBuffer
+{
+public:
+    unsigned int UBO;
+
+    FrameUniformBuffer() : UBO(0)
+    {
+    }
+
+    // creates the buffer and binds it to FRAME_UNIFORM_BINDING for the rest of the run
+    // ------------------------------------------------------------------------
+    void create()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, UBO);
+    }
+
+    // uploads this frame's data into orphaned storage, like InstanceBuffer (instancing.h)
+    // ------------------------------------------------------------------------
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightPosition, const glm::vec3& lightColor)
+    {
+        FrameUniformData data;
+        data.view = view;
+        data.projection = projection;
+        data.lightPosition = glm::vec4(lightPosition, 1.0f);
+        data.lightColor = glm::vec4(lightColor, 1.0f);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &data);
+    }
+
+    // deletes the GL buffer
+    void release()
+    {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+};
+#endif
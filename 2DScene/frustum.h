@@ -0,0 +1,261 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Include the SIMD detection header
+#include <simd.h>
+
+// View frustum culling. Every mesh carries an axis aligned box and a bounding sphere in its own
+// space; each frame they are moved to world space and tested against the six planes of
+// projection * view, four objects at a time. An object is culled when either volume is completely
+// outside one plane, objects that straddle a plane are kept.
+
+// Bounding volumes of a mesh in its own space
+struct MeshBounds
+{
+    glm::vec3 center;   // center of the box and the sphere
+    glm::vec3 extent;   // half size of the box along each axis
+    float radius;       // sphere around center
+};
+
+// bounds of a box given by its corners, the sphere is the box's circumsphere
+// ------------------------------------------------------------------------
+inline MeshBounds boundsFromBox(const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    MeshBounds bounds;
+    bounds.center = (minimum + maximum) * 0.5f;
+    bounds.extent = (maximum - minimum) * 0.5f;
+    bounds.radius = glm::length(bounds.extent);
+    return bounds;
+}
+
+// bounds of interleaved vertices whose first three floats are the position. The sphere is centered
+// on the box and only as large as the farthest vertex, which is tighter than the circumsphere.
+// ------------------------------------------------------------------------
+inline MeshBounds boundsFromVertices(const float* vertices, size_t vertexCount, int floatsPerVertex)
+{
+    if (vertexCount == 0)
+        return boundsFromBox(glm::vec3(0.0f), glm::vec3(0.0f));
+
+    glm::vec3 minimum(vertices[0], vertices[1], vertices[2]);
+    glm::vec3 maximum = minimum;
+    for (size_t v = 1; v < vertexCount; ++v)
+    {
+        glm::vec3 position(vertices[v * floatsPerVertex], vertices[v * floatsPerVertex + 1], vertices[v * floatsPerVertex + 2]);
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    MeshBounds bounds = boundsFromBox(minimum, maximum);
+    float farthest = 0.0f;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        glm::vec3 position(vertices[v * floatsPerVertex], vertices[v * floatsPerVertex + 1], vertices[v * floatsPerVertex + 2]);
+        farthest = std::max(farthest, glm::length(position - bounds.center));
+    }
+    bounds.radius = farthest;
+    return bounds;
+}
+
+// Planes of a view-projection matrix as (normal, distance), normalized so a.xyz . p + a.w is the
+// signed distance of p; inside is positive (Gribb and Hartmann)
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+inline Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+    // rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r)
+        rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];  // left
+    frustum.planes[1] = rows[3] - rows[0];  // right
+    frustum.planes[2] = rows[3] + rows[1];  // bottom
+    frustum.planes[3] = rows[3] - rows[1];  // top
+    frustum.planes[4] = rows[3] + rows[2];  // near
+    frustum.planes[5] = rows[3] - rows[2];  // far
+    for (glm::vec4& plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+// true when the vector plane tests are compiled in
+inline bool frustumCullingVectorized()
+{
+#ifdef SCENE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Objects of one frame in structure of arrays form, padded to whole batches of four
+class FrustumCuller
+{
+public:
+    FrustumCuller() : count(0), visibleCount(0)
+    {
+    }
+
+    // sets the planes the next cull() tests against
+    void setFrustum(const glm::mat4& viewProjection)
+    {
+        frustum = extractFrustum(viewProjection);
+    }
+
+    // forgets the objects of the last cull
+    void clear()
+    {
+        count = 0;
+        visibleCount = 0;
+    }
+
+    // moves a mesh's bounds to world space and queues them, returns the object's index
+    // ------------------------------------------------------------------------
+    size_t add(const MeshBounds& bounds, const glm::mat4& model)
+    {
+        if (count + 1 > centerX.size())
+            grow((count + 4) & ~size_t(3));
+
+        // box: the center moves with the model, the extent is the box's projection on each world axis
+        glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+        glm::vec3 extent;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            extent[axis] = std::fabs(model[0][axis]) * bounds.extent.x + std::fabs(model[1][axis]) * bounds.extent.y +
+                           std::fabs(model[2][axis]) * bounds.extent.z;
+        }
+        // sphere: scaled by the largest axis scale
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+        centerX[count] = center.x;
+        centerY[count] = center.y;
+        centerZ[count] = center.z;
+        extentX[count] = extent.x;
+        extentY[count] = extent.y;
+        extentZ[count] = extent.z;
+        radius[count] = bounds.radius * scale;
+        return count++;
+    }
+
+    // tests every queued object, visible() holds the results afterwards
+    // ------------------------------------------------------------------------
+    void cull()
+    {
+#ifdef SCENE_SSE2
+        cullBatches();
+#else
+        cullScalar();
+#endif
+    }
+
+    // same results as cull(), one object at a time
+    void cullScalar()
+    {
+        visibleCount = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            bool inside = true;
+            for (const glm::vec4& plane : frustum.planes)
+            {
+                float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+                float reach = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+                if (distance + reach < 0.0f || distance + radius[i] < 0.0f)
+                    inside = false;
+            }
+            visibleFlags[i] = inside;
+            visibleCount += inside ? 1 : 0;
+        }
+    }
+
+    bool visible(size_t object) const
+    {
+        return visibleFlags[object] != 0;
+    }
+
+    size_t objectCount() const
+    {
+        return count;
+    }
+
+    size_t visibleObjects() const
+    {
+        return visibleCount;
+    }
+
+private:
+    Frustum frustum;
+    size_t count;
+    size_t visibleCount;
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+    std::vector<unsigned char> visibleFlags;
+
+    // capacity is kept a multiple of four so the last batch can always load whole vectors
+    void grow(size_t capacity)
+    {
+        capacity = std::max(capacity, centerX.size() * 2);
+        for (std::vector<float>* lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius })
+            lane->resize(capacity, 0.0f);
+        visibleFlags.resize(capacity, 0);
+    }
+
+#ifdef SCENE_SSE2
+    // four objects against all six planes per iteration
+    void cullBatches()
+    {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        visibleCount = 0;
+        for (size_t i = 0; i < count; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centerX[i]);
+            __m128 cy = _mm_loadu_ps(&centerY[i]);
+            __m128 cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]);
+            __m128 ey = _mm_loadu_ps(&extentY[i]);
+            __m128 ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 r = _mm_loadu_ps(&radius[i]);
+
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4& plane : frustum.planes)
+            {
+                __m128 nx = _mm_set1_ps(plane.x);
+                __m128 ny = _mm_set1_ps(plane.y);
+                __m128 nz = _mm_set1_ps(plane.z);
+                // summed in the order cullScalar() does, so objects on a plane round the same way
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)),
+                    _mm_set1_ps(plane.w));
+                __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+                    _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), _mm_setzero_ps()));
+            }
+
+            int outsideBits = _mm_movemask_ps(outside);
+            size_t lanes = std::min<size_t>(4, count - i);
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                bool inside = (outsideBits & (1 << lane)) == 0;
+                visibleFlags[i + lane] = inside;
+                visibleCount += inside ? 1 : 0;
+            }
+        }
+    }
+#endif
+};
+#endif
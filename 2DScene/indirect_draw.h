@@ -0,0 +1,73 @@
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+
+// Multi-draw indirect submission (OpenGL 4.3). The draws of a frame are written to one buffer as
+// indirect commands and a run of draws that share their state is issued with a single
+// glMultiDrawElementsIndirect call. Each command's baseInstance selects the draw's transform and
+// material in the instance buffer, so the run needs no state changes between draws.
+
+// Layout glMultiDrawElementsIndirect reads, fixed by the GL specification
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;           // indices to draw
+    unsigned int instanceCount;
+    unsigned int firstIndex;      // in indices, not bytes
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// Indirect commands of one frame
+class IndirectBuffer
+{
+public:
+    unsigned int buffer;
+
+    IndirectBuffer() : buffer(0), capacity(0)
+    {
+    }
+
+    // creates the buffer, room for commandCount commands to start with
+    // ------------------------------------------------------------------------
+    void create(size_t commandCount)
+    {
+        glGenBuffers(1, &buffer);
+        capacity = commandCount;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    }
+
+    // replaces the commands with this frame's in orphaned storage, like InstanceBuffer (instancing.h).
+    // The buffer is left bound for draw().
+    // ------------------------------------------------------------------------
+    void upload(const DrawElementsIndirectCommand* commands, size_t count)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        capacity = std::max(capacity, count);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DrawElementsIndirectCommand), commands);
+    }
+
+    // draws commands first .. first + count - 1 of the last upload, the mesh VAO must be bound
+    void draw(size_t first, size_t count) const
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(count), 0);
+    }
+
+    // deletes the GL buffer
+    void release()
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        capacity = 0;
+    }
+
+private:
+    size_t capacity;
+};
+#endif
@@ -0,0 +1,113 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+// Per-instance data for hardware instanced draws. Copies of a mesh go into one instance buffer and
+// are drawn with a single instanced call, shader.vs reads each copy's transform and material from
+// vertex attributes that advance once per instance instead of once per vertex. A mesh drawn once
+// is a single instance, so its transform comes from here too instead of a uniform.
+
+// First vertex attribute location of the instance data, after position, color and texture coordinate
+const unsigned int INSTANCE_ATTRIBUTE = 3;
+
+// One copy of a mesh: its transform and the material word it is shaded with (see texture_array.h)
+struct MeshInstance
+{
+    glm::mat4 model;
+    unsigned int material;
+};
+
+// Instance data for one frame, written batch after batch into one streaming buffer. Each batch is
+// drawn with its offset as the base instance, so batches never overwrite data a draw still reads.
+//
+// Streaming buffers are orphaned once per frame: glBufferData with a null pointer gives the buffer
+// object fresh storage, while the previous frame's draws, possibly still queued on the GPU, keep
+// reading the storage they were issued with. Writing into that old storage instead would make the
+// driver stall until those draws finish. The per-frame uniform and indirect command buffers
+// (frame_uniforms.h, indirect_draw.h) are streamed the same way.
+class InstanceBuffer
+{
+public:
+    unsigned int VBO;
+
+    InstanceBuffer() : VBO(0), capacity(0), used(0)
+    {
+    }
+
+    // creates the buffer, room for instanceCount instances per frame to start with
+    // ------------------------------------------------------------------------
+    void create(size_t instanceCount)
+    {
+        glGenBuffers(1, &VBO);
+        capacity = instanceCount;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(MeshInstance), nullptr, GL_STREAM_DRAW);
+    }
+
+    // adds the instance attributes to a VAO, the instance data of every VAO comes from this buffer
+    // ------------------------------------------------------------------------
+    void attach(unsigned int vao) const
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // a mat4 attribute takes one location per column
+        for (unsigned int column = 0; column < 4; ++column)
+        {
+            glVertexAttribPointer(INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+                (void*)(offsetof(MeshInstance, model) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + column, 1);
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + column);
+        }
+        // material attribute, read as an integer
+        glVertexAttribIPointer(INSTANCE_ATTRIBUTE + 4, 1, GL_UNSIGNED_INT, sizeof(MeshInstance), (void*)offsetof(MeshInstance, material));
+        glVertexAttribDivisor(INSTANCE_ATTRIBUTE + 4, 1);
+        glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + 4);
+    }
+
+    // starts a frame: orphans last frame's storage (see the class comment)
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        used = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(MeshInstance), nullptr, GL_STREAM_DRAW);
+    }
+
+    // copies a batch into the buffer and returns its base instance. When the frame has more
+    // instances than the buffer holds it is orphaned into larger storage and filled from the start,
+    // draws already issued keep reading the old storage and the VAOs keep the same buffer object.
+    // ------------------------------------------------------------------------
+    unsigned int write(const MeshInstance* instances, size_t count)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (used + count > capacity)
+        {
+            capacity = std::max(capacity * 2, count);
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(MeshInstance), nullptr, GL_STREAM_DRAW);
+            used = 0;
+        }
+
+        unsigned int baseInstance = static_cast<unsigned int>(used);
+        glBufferSubData(GL_ARRAY_BUFFER, used * sizeof(MeshInstance), count * sizeof(MeshInstance), instances);
+        used += count;
+        return baseInstance;
+    }
+
+    // deletes the GL buffer
+    void release()
+    {
+        glDeleteBuffers(1, &VBO);
+        VBO = 0;
+        capacity = used = 0;
+    }
+
+private:
+    size_t capacity;
+    size_t used;
+};
+#endif
@@ -0,0 +1,369 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+
+#include <mesh_weld.h>
+#include <vertex_cache.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Vertex layouts the registry can upload. Generators always produce the float layout,
+// the registry converts when it uploads.
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT,    // 36 bytes: float3 position, float4 color, float2 texture coordinate
+    VERTEX_FORMAT_PACKED    // 16 bytes: half3 position (+pad), unorm8x4 color, half2 texture coordinate
+};
+
+// One vertex in VERTEX_FORMAT_PACKED. Texture coordinates stay half floats rather than
+// unorm16 because tiled surfaces (the plane) use coordinates well above 1.
+struct PackedVertex
+{
+    unsigned short position[4];
+    unsigned char color[4];
+    unsigned short texCoord[2];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Converts a float to IEEE half precision, rounding to nearest even
+inline unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    unsigned int sign = (bits >> 16) & 0x8000u;
+    int exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+    unsigned int mantissa = bits & 0x7fffffu;
+
+    // NaN and infinity
+    if (((bits >> 23) & 0xffu) == 0xffu)
+        return static_cast<unsigned short>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    // too large, clamp to infinity
+    if (exponent >= 31)
+        return static_cast<unsigned short>(sign | 0x7c00u);
+    // too small even for a denormal
+    if (exponent <= -11)
+        return static_cast<unsigned short>(sign);
+
+    unsigned int shift;
+    if (exponent <= 0)
+    {
+        // denormal: make the implicit leading one explicit and shift it down
+        mantissa |= 0x800000u;
+        shift = static_cast<unsigned int>(14 - exponent);
+        exponent = 0;
+    }
+    else
+    {
+        shift = 13;
+    }
+
+    unsigned int half = sign | (static_cast<unsigned int>(exponent) << 10) | (mantissa >> shift);
+    unsigned int remainder = mantissa & ((1u << shift) - 1u);
+    unsigned int halfway = 1u << (shift - 1u);
+    // a carry out of the mantissa correctly bumps the exponent
+    if (remainder > halfway || (remainder == halfway && (half & 1u)))
+        ++half;
+
+    return static_cast<unsigned short>(half);
+}
+
+// Converts a [0, 1] float to an 8 bit unsigned normalized value
+inline unsigned char floatToUnorm8(float value)
+{
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return static_cast<unsigned char>(value * 255.0f + 0.5f);
+}
+
+// Runs body(0) .. body(count - 1) in order; the per-mesh passes take any callable with this
+// signature, so a caller with worker threads can spread the meshes across them
+struct SerialForEach
+{
+    template <typename Body>
+    void operator()(size_t count, Body body) const
+    {
+        for (size_t i = 0; i < count; ++i)
+            body(i);
+    }
+};
+
+// Where one mesh lives inside the registry's shared buffers
+struct MeshRange
+{
+    int baseVertex;             // added to every index of the mesh
+    unsigned int firstIndex;    // offset of the mesh's first index in the EBO
+    unsigned int indexCount;    // number of indices to draw
+};
+
+// Packs every mesh into one VBO and one EBO under a single VAO. Meshes keep their own
+// zero-based indices and are drawn with a base vertex (drawInstanced), so the whole scene
+// needs one glBindVertexArray per frame no matter how many meshes it has.
+class MeshRegistry
+{
+public:
+    // interleaved position (3), color (4), texture coordinate (2)
+    static const int FLOATS_PER_VERTEX = 9;
+
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    // layout used by upload(), set it before uploading
+    VertexFormat Format;
+
+    MeshRegistry() : VAO(0), VBO(0), EBO(0), Format(VERTEX_FORMAT_FLOAT), vertexBytes(0)
+    {
+    }
+
+    // appends a mesh and returns its id, call before upload()
+    // ------------------------------------------------------------------------
+    int add(const float* vertices, size_t floatCount, const unsigned int* indices, size_t indexCount)
+    {
+        MeshRange range;
+        range.baseVertex = static_cast<int>(vertexData.size() / FLOATS_PER_VERTEX);
+        range.firstIndex = static_cast<unsigned int>(indexData.size());
+        range.indexCount = static_cast<unsigned int>(indexCount);
+        ranges.push_back(range);
+
+        vertexData.insert(vertexData.end(), vertices, vertices + floatCount);
+        indexData.insert(indexData.end(), indices, indices + indexCount);
+
+        return static_cast<int>(ranges.size()) - 1;
+    }
+
+    int add(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+    {
+        return add(vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+
+    template <size_t VertexFloats, size_t IndexCount>
+    int add(const std::array<float, VertexFloats>& vertices, const std::array<unsigned int, IndexCount>& indices)
+    {
+        return add(vertices.data(), VertexFloats, indices.data(), IndexCount);
+    }
+
+    // merges duplicate vertices inside every mesh, call before upload()
+    // ------------------------------------------------------------------------
+    template <typename ForEach = SerialForEach>
+    void weldVertices(float tolerance = MESH_WELD_TOLERANCE, ForEach forEach = ForEach())
+    {
+        std::vector<std::vector<float>> weldedVertices(ranges.size());
+        std::vector<std::vector<unsigned int>> weldedIndices(ranges.size());
+        forEach(ranges.size(), [&](size_t mesh) {
+            const MeshRange& range = ranges[mesh];
+            weldedIndices[mesh].assign(indexData.begin() + range.firstIndex, indexData.begin() + range.firstIndex + range.indexCount);
+            weldedVertices[mesh] = weldMesh(meshVertices(static_cast<int>(mesh)), vertexCount(static_cast<int>(mesh)),
+                FLOATS_PER_VERTEX, weldedIndices[mesh], tolerance);
+        });
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        for (size_t mesh = 0; mesh < ranges.size(); ++mesh)
+        {
+            MeshRange& range = ranges[mesh];
+            range.baseVertex = static_cast<int>(vertices.size() / FLOATS_PER_VERTEX);
+            range.firstIndex = static_cast<unsigned int>(indices.size());
+            range.indexCount = static_cast<unsigned int>(weldedIndices[mesh].size());
+            vertices.insert(vertices.end(), weldedVertices[mesh].begin(), weldedVertices[mesh].end());
+            indices.insert(indices.end(), weldedIndices[mesh].begin(), weldedIndices[mesh].end());
+        }
+        vertexData.swap(vertices);
+        indexData.swap(indices);
+    }
+
+    // number of vertices of one mesh, valid until upload()
+    // meshes are stored back to back, each one ends where the next begins
+    size_t vertexCount(int mesh) const
+    {
+        size_t end = mesh + 1 < meshCount() ? ranges[mesh + 1].baseVertex : vertexData.size() / FLOATS_PER_VERTEX;
+        return end - ranges[mesh].baseVertex;
+    }
+
+    // float vertices of one mesh, valid until upload()
+    const float* meshVertices(int mesh) const
+    {
+        return vertexData.data() + static_cast<size_t>(ranges[mesh].baseVertex) * FLOATS_PER_VERTEX;
+    }
+
+    // reorders every mesh's triangles for the post-transform vertex cache, call before upload()
+    // ------------------------------------------------------------------------
+    template <typename ForEach = SerialForEach>
+    void optimizeVertexCache(int cacheSize = VERTEX_CACHE_SIZE, ForEach forEach = ForEach())
+    {
+        // meshes own disjoint parts of the index buffer
+        forEach(ranges.size(), [&](size_t mesh) {
+            tipsifyIndices(indexData.data() + ranges[mesh].firstIndex, ranges[mesh].indexCount, cacheSize);
+        });
+    }
+
+    // how one mesh's current index order uses the vertex cache, valid until upload()
+    VertexCacheStats vertexCacheStats(int mesh, int cacheSize = VERTEX_CACHE_SIZE) const
+    {
+        const MeshRange& range = ranges[mesh];
+        return measureVertexCache(indexData.data() + range.firstIndex, range.indexCount, cacheSize);
+    }
+
+    // creates the shared buffers and the vertex layout, then drops the CPU copies
+    // ------------------------------------------------------------------------
+    void upload()
+    {
+        std::vector<unsigned char> vertices = vertexBlob();
+        uploadBlobs(vertices.data(), vertices.size(), indexData.data(), indexData.size() * sizeof(unsigned int));
+
+        std::vector<float>().swap(vertexData);
+        std::vector<unsigned int>().swap(indexData);
+    }
+
+    // creates the shared buffers from data that is already in Format's layout (see MeshCache)
+    // ------------------------------------------------------------------------
+    void uploadBlobs(const void* vertices, size_t vertexByteCount, const void* indices, size_t indexByteCount)
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        vertexBytes = vertexByteCount;
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexByteCount, indices, GL_STATIC_DRAW);
+
+        setVertexAttributes();
+
+        glBindVertexArray(0);
+    }
+
+    // vertex buffer contents in the current Format, valid until upload()
+    std::vector<unsigned char> vertexBlob() const
+    {
+        if (Format == VERTEX_FORMAT_PACKED)
+            return packVertices();
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertexData.data());
+        return std::vector<unsigned char>(bytes, bytes + vertexData.size() * sizeof(float));
+    }
+
+    // index buffer contents, valid until upload()
+    const std::vector<unsigned int>& indices() const
+    {
+        return indexData;
+    }
+
+    const std::vector<MeshRange>& meshRanges() const
+    {
+        return ranges;
+    }
+
+    // replaces every mesh at once, for buffers uploaded with uploadBlobs()
+    void setRanges(const std::vector<MeshRange>& meshes)
+    {
+        ranges = meshes;
+    }
+
+    // draws instanceCount copies of one mesh, their instance data starts at baseInstance
+    void drawInstanced(int mesh, GLsizei instanceCount, unsigned int baseInstance) const
+    {
+        const MeshRange& range = ranges[mesh];
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+            (void*)(range.firstIndex * sizeof(unsigned int)), instanceCount, range.baseVertex, baseInstance);
+    }
+
+    const MeshRange& range(int mesh) const
+    {
+        return ranges[mesh];
+    }
+
+    int meshCount() const
+    {
+        return static_cast<int>(ranges.size());
+    }
+
+    // size of the uploaded vertex buffer
+    size_t vertexBufferBytes() const
+    {
+        return vertexBytes;
+    }
+
+    // bytes per vertex in the current format
+    GLsizei vertexStride() const
+    {
+        return vertexStride(Format);
+    }
+
+    // bytes per vertex in a format
+    static GLsizei vertexStride(VertexFormat format)
+    {
+        return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : FLOATS_PER_VERTEX * sizeof(float);
+    }
+
+    // deletes the GL objects
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    std::vector<MeshRange> ranges;
+    std::vector<float> vertexData;
+    std::vector<unsigned int> indexData;
+    size_t vertexBytes;
+
+    // converts the float vertices to the packed layout
+    std::vector<unsigned char> packVertices() const
+    {
+        std::vector<unsigned char> bytes(vertexData.size() / FLOATS_PER_VERTEX * sizeof(PackedVertex));
+        PackedVertex* packed = reinterpret_cast<PackedVertex*>(bytes.data());
+        for (size_t i = 0; i < vertexData.size() / FLOATS_PER_VERTEX; ++i)
+        {
+            const float* v = &vertexData[i * FLOATS_PER_VERTEX];
+            PackedVertex& p = packed[i];
+            p.position[0] = floatToHalf(v[0]);
+            p.position[1] = floatToHalf(v[1]);
+            p.position[2] = floatToHalf(v[2]);
+            p.position[3] = floatToHalf(1.0f);
+            p.color[0] = floatToUnorm8(v[3]);
+            p.color[1] = floatToUnorm8(v[4]);
+            p.color[2] = floatToUnorm8(v[5]);
+            p.color[3] = floatToUnorm8(v[6]);
+            p.texCoord[0] = floatToHalf(v[7]);
+            p.texCoord[1] = floatToHalf(v[8]);
+        }
+        return bytes;
+    }
+
+    // describes the current format to the bound VAO, the shader inputs are the same for both
+    void setVertexAttributes() const
+    {
+        const GLsizei stride = vertexStride();
+        if (Format == VERTEX_FORMAT_PACKED)
+        {
+            // position attribute
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, position));
+            // color attribute
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, color));
+            // texture attibute
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texCoord));
+        }
+        else
+        {
+            // position attribute
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            // color attribute
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+            // texture attibute
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(7 * sizeof(float)));
+        }
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+    }
+};
+#endif
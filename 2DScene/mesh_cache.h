@@ -0,0 +1,330 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <hash.h>
+#include <mesh.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bump when the file layout changes
+const std::uint32_t MESH_CACHE_VERSION = 1;
+
+// Start of a mesh cache file. The range table, vertex blob and index blob follow at the given
+// offsets, each 16 byte aligned, already in the layout glBufferData expects.
+struct MeshCacheHeader
+{
+    char magic[4];                  // "MSHC"
+    std::uint32_t version;          // MESH_CACHE_VERSION
+    std::uint64_t key;              // hash of everything the meshes were generated from
+    std::uint32_t format;           // VertexFormat of the vertex blob
+    std::uint32_t meshCount;        // entries in the range table
+    std::uint64_t rangesOffset;
+    std::uint64_t vertexOffset;
+    std::uint64_t vertexBytes;
+    std::uint64_t indexOffset;
+    std::uint64_t indexBytes;
+};
+static_assert(sizeof(MeshRange) == 12, "MeshRange is stored in the mesh cache as is");
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() : data(nullptr), size(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+    {
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps the file, returns false if it does not exist or is empty
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data)
+        {
+            close();
+            return false;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // the mapping stays valid after the descriptor is closed
+        ::close(descriptor);
+        if (mapped == MAP_FAILED)
+            return false;
+        data = mapped;
+        size = static_cast<size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data)
+            munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const unsigned char* bytes() const
+    {
+        return static_cast<const unsigned char*>(data);
+    }
+
+    size_t byteCount() const
+    {
+        return size;
+    }
+
+private:
+    void* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+// Versioned binary cache of the registry's GPU-ready buffers. A hit maps the file and hands the
+// bytes straight to glBufferData, so later runs skip generation, packing and parsing entirely.
+class MeshCache
+{
+public:
+    // uploads the registry from the cache file, false if it is missing, stale or damaged. meshCount
+    // is the number of meshes the caller will look up in the registry.
+    // ------------------------------------------------------------------------
+    static bool load(MeshRegistry& registry, const std::string& path, std::uint64_t key, size_t meshCount)
+    {
+        MappedFile file;
+        MeshCacheHeader header;
+        if (!open(file, header, path, key, registry.Format, meshCount))
+            return false;
+
+        std::vector<MeshRange> ranges(header.meshCount);
+        std::memcpy(ranges.data(), file.bytes() + header.rangesOffset, ranges.size() * sizeof(MeshRange));
+        registry.setRanges(ranges);
+        registry.uploadBlobs(file.bytes() + header.vertexOffset, static_cast<size_t>(header.vertexBytes),
+            file.bytes() + header.indexOffset, static_cast<size_t>(header.indexBytes));
+        return true;
+    }
+
+    // checks that load() would succeed without touching GL, so it can run on any thread
+    // ------------------------------------------------------------------------
+    static bool matches(const std::string& path, std::uint64_t key, VertexFormat format, size_t meshCount)
+    {
+        MappedFile file;
+        MeshCacheHeader header;
+        return open(file, header, path, key, format, meshCount);
+    }
+
+    // writes the registry's meshes, call after adding them and before upload()
+    // ------------------------------------------------------------------------
+    static bool save(const MeshRegistry& registry, const std::string& path, std::uint64_t key)
+    {
+        std::vector<unsigned char> vertices = registry.vertexBlob();
+        const std::vector<unsigned int>& indices = registry.indices();
+        const std::vector<MeshRange>& ranges = registry.meshRanges();
+
+        MeshCacheHeader header = {};
+        std::memcpy(header.magic, "MSHC", 4);
+        header.version = MESH_CACHE_VERSION;
+        header.key = key;
+        header.format = static_cast<std::uint32_t>(registry.Format);
+        header.meshCount = static_cast<std::uint32_t>(ranges.size());
+        header.rangesOffset = align(sizeof(header));
+        header.vertexOffset = align(header.rangesOffset + ranges.size() * sizeof(MeshRange));
+        header.vertexBytes = vertices.size();
+        header.indexOffset = align(header.vertexOffset + header.vertexBytes);
+        header.indexBytes = indices.size() * sizeof(unsigned int);
+
+        // written to a file of this process's own next to the target and renamed over it, so a
+        // concurrent run never maps a half-written file and there is always a whole one in place
+        std::string temporary = path + "." + std::to_string(processId()) + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITTEN: " << path << std::endl;
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            pad(out, header.rangesOffset);
+            out.write(reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(MeshRange));
+            pad(out, header.vertexOffset);
+            out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size());
+            pad(out, header.indexOffset);
+            out.write(reinterpret_cast<const char*>(indices.data()), header.indexBytes);
+            if (!out)
+            {
+                std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITTEN: " << path << std::endl;
+                return false;
+            }
+        }
+        if (!replaceFile(temporary, path))
+        {
+            std::remove(temporary.c_str());
+            std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // maps the file and validates its header against the key, format and file size, and its ranges
+    // against the expected mesh count, the index data and the vertex data
+    // ------------------------------------------------------------------------
+    static bool open(MappedFile& file, MeshCacheHeader& header, const std::string& path, std::uint64_t key, VertexFormat format,
+        size_t meshCount)
+    {
+        if (!file.open(path))
+            return false;
+
+        if (file.byteCount() < sizeof(MeshCacheHeader))
+            return reject(path, "TRUNCATED");
+        std::memcpy(&header, file.bytes(), sizeof(header));
+
+        if (std::memcmp(header.magic, "MSHC", 4) != 0 || header.version != MESH_CACHE_VERSION)
+            return reject(path, "WRONG_VERSION");
+        // a different key or format is a normal miss, the file is rewritten
+        if (header.key != key || header.format != static_cast<std::uint32_t>(format))
+            return false;
+        std::uint64_t rangeBytes = static_cast<std::uint64_t>(header.meshCount) * sizeof(MeshRange);
+        if (!fits(header.rangesOffset, rangeBytes, file.byteCount()) ||
+            !fits(header.vertexOffset, header.vertexBytes, file.byteCount()) ||
+            !fits(header.indexOffset, header.indexBytes, file.byteCount()))
+            return reject(path, "TRUNCATED");
+
+        // the key matched, so these only fail for a damaged file; drawing from it would read past
+        // the range list on the CPU and past the index or vertex buffer on the GPU
+        if (header.meshCount != meshCount)
+            return reject(path, "WRONG_MESH_COUNT");
+        std::uint64_t indexCount = header.indexBytes / sizeof(unsigned int);
+        std::uint64_t vertexCount = header.vertexBytes / MeshRegistry::vertexStride(format);
+        for (size_t mesh = 0; mesh < meshCount; ++mesh)
+        {
+            MeshRange range;
+            std::memcpy(&range, file.bytes() + header.rangesOffset + mesh * sizeof(MeshRange), sizeof(range));
+            if (static_cast<std::uint64_t>(range.firstIndex) + range.indexCount > indexCount || range.baseVertex < 0)
+                return reject(path, "RANGE_OUT_OF_BOUNDS");
+
+            // every vertex the range's indices reach must be in the vertex data
+            const unsigned char* indices = file.bytes() + header.indexOffset + static_cast<std::uint64_t>(range.firstIndex) * sizeof(unsigned int);
+            for (unsigned int i = 0; i < range.indexCount; ++i)
+            {
+                unsigned int index;
+                std::memcpy(&index, indices + i * sizeof(unsigned int), sizeof(index));
+                if (static_cast<std::uint64_t>(range.baseVertex) + index >= vertexCount)
+                    return reject(path, "RANGE_OUT_OF_BOUNDS");
+            }
+        }
+        return true;
+    }
+
+    static unsigned long processId()
+    {
+#ifdef _WIN32
+        return GetCurrentProcessId();
+#else
+        return static_cast<unsigned long>(getpid());
+#endif
+    }
+
+    // moves source over target in one step; std::rename does not replace an existing file on Windows.
+    // Fails when another run has the target mapped there, which keeps that run's file
+    static bool replaceFile(const std::string& source, const std::string& target)
+    {
+#ifdef _WIN32
+        return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+    }
+
+    static std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + 15) & ~static_cast<std::uint64_t>(15);
+    }
+
+    static bool fits(std::uint64_t offset, std::uint64_t bytes, size_t fileSize)
+    {
+        return offset <= fileSize && bytes <= fileSize - offset;
+    }
+
+    // zero fills the stream up to an offset
+    static void pad(std::ofstream& out, std::uint64_t offset)
+    {
+        while (static_cast<std::uint64_t>(out.tellp()) < offset)
+            out.put('\0');
+    }
+
+    static bool reject(const std::string& path, const char* reason)
+    {
+        std::cout << "ERROR::MESH_CACHE::" << reason << ": " << path << std::endl;
+        return false;
+    }
+};
+#endif
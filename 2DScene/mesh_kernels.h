@@ -0,0 +1,311 @@
+#ifndef MESH_KERNELS_H
+#define MESH_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Include the SIMD detection header
+#include <simd.h>
+
+// Vertex writers for the tessellated primitives. They fill a caller-sized buffer with the same
+// interleaved 9 float layout the generators always produced (position, color, texture coordinate),
+// four vertices per iteration when SSE2 is available. Every writer has a *Scalar twin that is the
+// original per-vertex math; the vector path matches it within MESH_KERNEL_TOLERANCE.
+
+// largest position difference allowed between a vector kernel and its scalar twin, relative to the radius
+const float MESH_KERNEL_TOLERANCE = 1.0e-6f;
+
+// true when the vector kernels are compiled in
+inline bool meshKernelsVectorized()
+{
+#ifdef SCENE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef SCENE_SSE2
+// sin and cos of four angles at once (Cephes single precision polynomials, good to a couple of ulp
+// for the |x| < 8192 range the generators use)
+// ------------------------------------------------------------------------
+inline void sinCos4(__m128 x, __m128* sines, __m128* cosines)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+
+    // octant of the angle, rounded up to even
+    __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    octant = _mm_add_epi32(octant, _mm_set1_epi32(1));
+    octant = _mm_and_si128(octant, _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(octant);
+
+    __m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+    signSin = _mm_xor_ps(signSin, swapSignSin);
+
+    // extended precision reduction to [-pi/4, pi/4]
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+    __m128 z = _mm_mul_ps(x, x);
+
+    // cosine polynomial
+    __m128 c = _mm_set1_ps(2.443315711809948e-5f);
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+    c = _mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    c = _mm_add_ps(c, _mm_set1_ps(1.0f));
+
+    // sine polynomial
+    __m128 s = _mm_set1_ps(-1.9515295891e-4f);
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+    // odd octants swap the two polynomials
+    __m128 sinPart = _mm_or_ps(_mm_and_ps(polyMask, s), _mm_andnot_ps(polyMask, c));
+    __m128 cosPart = _mm_or_ps(_mm_and_ps(polyMask, c), _mm_andnot_ps(polyMask, s));
+    *sines = _mm_xor_ps(sinPart, signSin);
+    *cosines = _mm_xor_ps(cosPart, signCos);
+}
+
+// writes four vertices that share a color
+inline void storeVertices4(float* out, __m128 x, __m128 y, __m128 z, __m128 u, __m128 v, __m128 rgba)
+{
+    // rows become (x, y, z, u) of one vertex each
+    _MM_TRANSPOSE4_PS(x, y, z, u);
+    const __m128 rows[4] = { x, y, z, u };
+    float vs[4];
+    _mm_storeu_ps(vs, v);
+    for (int k = 0; k < 4; ++k, out += 9)
+    {
+        _mm_storeu_ps(out, rows[k]);        // x y z (u is overwritten by the color)
+        _mm_storeu_ps(out + 3, rgba);       // r g b a
+        out[7] = _mm_cvtss_f32(_mm_shuffle_ps(rows[k], rows[k], _MM_SHUFFLE(3, 3, 3, 3)));
+        out[8] = vs[k];
+    }
+}
+#endif
+
+// writes one vertex
+inline float* storeVertex(float* out, float x, float y, float z, const float rgba[4], float u, float v)
+{
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+    out[3] = rgba[0];
+    out[4] = rgba[1];
+    out[5] = rgba[2];
+    out[6] = rgba[3];
+    out[7] = u;
+    out[8] = v;
+    return out + 9;
+}
+
+// cos/sin of i * step for i = 0 .. count - 1
+// ------------------------------------------------------------------------
+inline void sinCosStepsScalar(float step, int count, float* sines, float* cosines)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float angle = i * step;
+        cosines[i] = std::cos(angle);
+        sines[i] = std::sin(angle);
+    }
+}
+
+inline void sinCosSteps(float step, int count, float* sines, float* cosines)
+{
+#ifdef SCENE_SSE2
+    int i = 0;
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 angle = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lane), _mm_set1_ps(step));
+        __m128 s, c;
+        sinCos4(angle, &s, &c);
+        _mm_storeu_ps(sines + i, s);
+        _mm_storeu_ps(cosines + i, c);
+    }
+    for (; i < count; ++i)
+    {
+        float angle = i * step;
+        cosines[i] = std::cos(angle);
+        sines[i] = std::sin(angle);
+    }
+#else
+    sinCosStepsScalar(step, count, sines, cosines);
+#endif
+}
+
+// cos/sin of span * i / divisions for i = 0 .. divisions (the sphere's way of spacing angles)
+// ------------------------------------------------------------------------
+inline void sinCosFractionsScalar(float span, int divisions, float* sines, float* cosines)
+{
+    for (int i = 0; i <= divisions; ++i)
+    {
+        float angle = span * i / divisions;
+        cosines[i] = std::cos(angle);
+        sines[i] = std::sin(angle);
+    }
+}
+
+inline void sinCosFractions(float span, int divisions, float* sines, float* cosines)
+{
+#ifdef SCENE_SSE2
+    int i = 0;
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (; i + 4 <= divisions + 1; i += 4)
+    {
+        __m128 index = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lane);
+        __m128 angle = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(span), index), _mm_set1_ps(static_cast<float>(divisions)));
+        __m128 s, c;
+        sinCos4(angle, &s, &c);
+        _mm_storeu_ps(sines + i, s);
+        _mm_storeu_ps(cosines + i, c);
+    }
+    for (; i <= divisions; ++i)
+    {
+        float angle = span * i / divisions;
+        cosines[i] = std::cos(angle);
+        sines[i] = std::sin(angle);
+    }
+#else
+    sinCosFractionsScalar(span, divisions, sines, cosines);
+#endif
+}
+
+// number of floats writeSphereVertices produces
+inline size_t sphereFloatCount(int rings, int segments)
+{
+    return static_cast<size_t>(rings + 1) * (segments + 1) * 9;
+}
+
+// UV sphere around the z axis, (rings + 1) x (segments + 1) vertices, seams duplicated
+// ------------------------------------------------------------------------
+inline void writeSphereVerticesScalar(float* out, int rings, int segments, float pi, float radius, const float rgba[4])
+{
+    for (int i = 0; i <= rings; ++i)
+    {
+        float phi = pi * i / rings; // Vertical angle
+        for (int j = 0; j <= segments; ++j)
+        {
+            float theta = (2 * pi) * j / segments; // Horizontal angle
+            float x = radius * std::sin(phi) * std::cos(theta);
+            float y = radius * std::sin(phi) * std::sin(theta);
+            float z = radius * std::cos(phi);
+            out = storeVertex(out, x, y, z, rgba, static_cast<float>(j) / segments, static_cast<float>(i) / rings);
+        }
+    }
+}
+
+inline void writeSphereVertices(float* out, int rings, int segments, float pi, float radius, const float rgba[4])
+{
+#ifdef SCENE_SSE2
+    // the grid is the outer product of one ring of phi and one ring of theta, so only
+    // rings + segments + 2 sin/cos pairs are evaluated instead of one per vertex
+    std::vector<float> sinPhi(rings + 1), cosPhi(rings + 1), sinTheta(segments + 1), cosTheta(segments + 1);
+    sinCosFractions(pi, rings, sinPhi.data(), cosPhi.data());
+    sinCosFractions(2 * pi, segments, sinTheta.data(), cosTheta.data());
+
+    const __m128 color = _mm_loadu_ps(rgba);
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 segmentCount = _mm_set1_ps(static_cast<float>(segments));
+
+    for (int i = 0; i <= rings; ++i)
+    {
+        float ringRadius = radius * sinPhi[i];
+        float z = radius * cosPhi[i];
+        float v = static_cast<float>(i) / rings;
+
+        int j = 0;
+        for (; j + 4 <= segments + 1; j += 4, out += 36)
+        {
+            __m128 r = _mm_set1_ps(ringRadius);
+            __m128 u = _mm_div_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(j)), lane), segmentCount);
+            storeVertices4(out, _mm_mul_ps(r, _mm_loadu_ps(&cosTheta[j])), _mm_mul_ps(r, _mm_loadu_ps(&sinTheta[j])),
+                _mm_set1_ps(z), u, _mm_set1_ps(v), color);
+        }
+        for (; j <= segments; ++j)
+            out = storeVertex(out, ringRadius * cosTheta[j], ringRadius * sinTheta[j], z, rgba, static_cast<float>(j) / segments, v);
+    }
+#else
+    writeSphereVerticesScalar(out, rings, segments, pi, radius, rgba);
+#endif
+}
+
+// One ring of a cylinder wall at height y, u runs around the ring and v is constant
+// ------------------------------------------------------------------------
+inline void writeCylinderRowScalar(float* out, int sides, float y, float v, float radius, const float rgba[4],
+    const float* cosines, const float* sines)
+{
+    for (int i = 0; i < sides; ++i)
+        out = storeVertex(out, radius * cosines[i], y, radius * sines[i], rgba,
+            static_cast<float>(i) / static_cast<float>(sides), v);
+}
+
+inline void writeCylinderRow(float* out, int sides, float y, float v, float radius, const float rgba[4],
+    const float* cosines, const float* sines)
+{
+#ifdef SCENE_SSE2
+    const __m128 color = _mm_loadu_ps(rgba);
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 sideCount = _mm_set1_ps(static_cast<float>(sides));
+
+    int i = 0;
+    for (; i + 4 <= sides; i += 4, out += 36)
+    {
+        __m128 u = _mm_div_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lane), sideCount);
+        storeVertices4(out, _mm_mul_ps(r, _mm_loadu_ps(cosines + i)), _mm_set1_ps(y), _mm_mul_ps(r, _mm_loadu_ps(sines + i)),
+            u, _mm_set1_ps(v), color);
+    }
+    for (; i < sides; ++i)
+        out = storeVertex(out, radius * cosines[i], y, radius * sines[i], rgba,
+            static_cast<float>(i) / static_cast<float>(sides), v);
+#else
+    writeCylinderRowScalar(out, sides, y, v, radius, rgba, cosines, sines);
+#endif
+}
+
+// One ring of a cap at height y, texture coordinates map the unit circle onto the texture
+// ------------------------------------------------------------------------
+inline void writeCapRowScalar(float* out, int sides, float y, float radius, const float rgba[4],
+    const float* cosines, const float* sines)
+{
+    for (int i = 0; i < sides; ++i)
+        out = storeVertex(out, radius * cosines[i], y, radius * sines[i], rgba,
+            0.5f + 0.5f * cosines[i], 0.5f + 0.5f * sines[i]);
+}
+
+inline void writeCapRow(float* out, int sides, float y, float radius, const float rgba[4],
+    const float* cosines, const float* sines)
+{
+#ifdef SCENE_SSE2
+    const __m128 color = _mm_loadu_ps(rgba);
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    int i = 0;
+    for (; i + 4 <= sides; i += 4, out += 36)
+    {
+        __m128 c = _mm_loadu_ps(cosines + i);
+        __m128 s = _mm_loadu_ps(sines + i);
+        storeVertices4(out, _mm_mul_ps(r, c), _mm_set1_ps(y), _mm_mul_ps(r, s),
+            _mm_add_ps(half, _mm_mul_ps(half, c)), _mm_add_ps(half, _mm_mul_ps(half, s)), color);
+    }
+    for (; i < sides; ++i)
+        out = storeVertex(out, radius * cosines[i], y, radius * sines[i], rgba,
+            0.5f + 0.5f * cosines[i], 0.5f + 0.5f * sines[i]);
+#else
+    writeCapRowScalar(out, sides, y, radius, rgba, cosines, sines);
+#endif
+}
+#endif
@@ -0,0 +1,88 @@
+#ifndef MESH_WELD_H
+#define MESH_WELD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Vertex welding: merges vertices whose attributes all match within a tolerance and points the
+// indices at the survivors. Triangle soups such as the cone repeat every shared corner, welding
+// them shrinks the vertex buffer and lets the post-transform cache reuse the shaded corners.
+
+// Largest difference per attribute for two vertices to count as one
+const float MESH_WELD_TOLERANCE = 1e-6f;
+
+// Welds one mesh. vertices holds vertexCount interleaved vertices of floatsPerVertex floats, the
+// first three being the position. Returns the welded vertices in first-use order, so a mesh without
+// duplicates comes back unchanged; indices are rewritten in place and triangles that collapse to a
+// line or a point are dropped.
+// ------------------------------------------------------------------------
+inline std::vector<float> weldMesh(const float* vertices, size_t vertexCount, int floatsPerVertex,
+    std::vector<unsigned int>& indices, float tolerance = MESH_WELD_TOLERANCE)
+{
+    std::vector<float> welded;
+    welded.reserve(vertexCount * floatsPerVertex);
+    std::vector<unsigned int> remap(vertexCount);
+
+    // welded vertices bucketed by position on a grid of tolerance sized cells, chained through next
+    std::unordered_map<std::uint64_t, unsigned int> cells;
+    std::vector<unsigned int> next;
+    const unsigned int END = ~0u;
+    float cellSize = tolerance > 0.0f ? tolerance : 1e-30f;
+    auto cellKey = [](long long x, long long y, long long z) {
+        return static_cast<std::uint64_t>(x) * 73856093ull ^ static_cast<std::uint64_t>(y) * 19349663ull ^
+               static_cast<std::uint64_t>(z) * 83492791ull;
+    };
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = vertices + v * floatsPerVertex;
+        long long cx = static_cast<long long>(std::floor(vertex[0] / cellSize));
+        long long cy = static_cast<long long>(std::floor(vertex[1] / cellSize));
+        long long cz = static_cast<long long>(std::floor(vertex[2] / cellSize));
+
+        // a match within the tolerance is in this cell or a neighbouring one
+        unsigned int match = END;
+        for (long long dx = -1; dx <= 1 && match == END; ++dx)
+            for (long long dy = -1; dy <= 1 && match == END; ++dy)
+                for (long long dz = -1; dz <= 1 && match == END; ++dz)
+                {
+                    auto cell = cells.find(cellKey(cx + dx, cy + dy, cz + dz));
+                    for (unsigned int w = cell == cells.end() ? END : cell->second; w != END && match == END; w = next[w])
+                    {
+                        const float* candidate = welded.data() + static_cast<size_t>(w) * floatsPerVertex;
+                        bool same = true;
+                        for (int f = 0; f < floatsPerVertex && same; ++f)
+                            same = std::fabs(candidate[f] - vertex[f]) <= tolerance;
+                        if (same)
+                            match = w;
+                    }
+                }
+
+        if (match == END)
+        {
+            match = static_cast<unsigned int>(next.size());
+            welded.insert(welded.end(), vertex, vertex + floatsPerVertex);
+            unsigned int& head = cells.emplace(cellKey(cx, cy, cz), END).first->second;
+            next.push_back(head);
+            head = match;
+        }
+        remap[v] = match;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if (a == b || b == c || a == c)
+            continue;
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    indices.resize(kept);
+    return welded;
+}
+#endif
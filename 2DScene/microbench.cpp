@@ -0,0 +1,156 @@
+// Include the microbenchmark helpers header
+#include <microbench.h>
+// Include the texture compression header
+#include <texture_compress.h>
+// Include the mip chain header
+#include <texture_mips.h>
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Function to time the vector frustum test and compare it against the scalar one
+// Spheres and boxes scattered all around the camera, so about as many are culled as kept
+bool checkFrustumCulling(const glm::mat4& viewProjection, const MeshBounds& box, const MeshBounds& sphere)
+{
+    const int repetitions = 20;
+    bool passed = true;
+    MicrobenchRandom random;
+
+    std::cout << "objects\tscalar (ms)\t" << vectorColumn(frustumCullingVectorized()) << " (ms)\tspeedup\tvisible" << std::endl;
+    for (int count : { 16, 1024, 65536 })
+    {
+        FrustumCuller scalar, vector;
+        scalar.setFrustum(viewProjection);
+        vector.setFrustum(viewProjection);
+        for (int i = 0; i < count; ++i)
+        {
+            glm::mat4 model = glm::translate(glm::vec3(random.uniform(-20.0f, 20.0f), random.uniform(-20.0f, 20.0f), random.uniform(-40.0f, 3.0f))) *
+                glm::rotate(random.uniform(0.0f, 6.28f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::vec3(random.uniform(0.1f, 2.0f)));
+            scalar.add((i % 2) ? sphere : box, model);
+            vector.add((i % 2) ? sphere : box, model);
+        }
+
+        double scalarMs = microbenchMs(repetitions, [&] { scalar.cullScalar(); });
+        double vectorMs = microbenchMs(repetitions, [&] { vector.cull(); });
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (scalar.visible(i) != vector.visible(i))
+            {
+                std::cout << "ERROR::CULLING::MISMATCH: object " << i << " of " << count << std::endl;
+                passed = false;
+                break;
+            }
+        }
+        std::cout << count << "\t" << scalarMs << "\t" << vectorMs << "\t" << scalarMs / vectorMs << "x\t" << vector.visibleObjects() << std::endl;
+    }
+
+    // a box in front of the camera is kept, one behind it is not
+    FrustumCuller known;
+    known.setFrustum(viewProjection);
+    known.add(box, glm::translate(glm::vec3(0.0f, 0.0f, -2.0f)));
+    known.add(box, glm::translate(glm::vec3(0.0f, 0.0f, 8.0f)));
+    known.cull();
+    passed &= known.visible(0) && !known.visible(1);
+
+    return reportCheck("culling", passed);
+}
+
+// Function to time the BC7 encoder and compare the vector index search against the scalar one
+// Encodes the test image both ways; the blocks must be the same byte for byte and decode close to
+// the source. A red/green checker block, whose channels cancel out, must keep both of its colors.
+bool checkTextureCompression()
+{
+    const int size = 256;
+    const int repetitions = 5;
+    std::vector<unsigned char> rgba = microbenchImage(size);
+
+    size_t levelBytes = bc7LevelBytes(size, size);
+    std::vector<unsigned char> scalar(levelBytes), vector(levelBytes);
+    double scalarMs = microbenchMs(repetitions, [&] { encodeBC7Rows(rgba.data(), size, size, 0, size / 4, scalar.data(), false); });
+    double vectorMs = microbenchMs(repetitions, [&] { encodeBC7Rows(rgba.data(), size, size, 0, size / 4, vector.data(), true); });
+
+    bool passed = scalar == vector;
+    if (!passed)
+        std::cout << "ERROR::TEXTURE_COMPRESSION::MISMATCH: the vector encoder wrote different blocks" << std::endl;
+
+    double squaredError = 0.0;
+    unsigned char texels[64];
+    for (size_t block = 0; block < levelBytes / BC7_BLOCK_BYTES; ++block)
+    {
+        passed &= decodeBC7Block(&vector[block * BC7_BLOCK_BYTES], texels);
+        int bx = static_cast<int>(block % (size / 4)) * 4, by = static_cast<int>(block / (size / 4)) * 4;
+        for (int t = 0; t < 64; ++t)
+        {
+            double d = texels[t] - rgba[((static_cast<size_t>(by) + t / 16) * size + bx + (t / 4) % 4) * 4 + t % 4];
+            squaredError += d * d;
+        }
+    }
+    double psnr = 10.0 * std::log10(255.0 * 255.0 / (squaredError / rgba.size()));
+    passed &= psnr > 30.0;
+
+    unsigned char checker[64], block[BC7_BLOCK_BYTES];
+    for (int t = 0; t < 16; ++t)
+    {
+        bool red = (t % 4 + t / 4) % 2 == 0;
+        checker[t * 4 + 0] = red ? 255 : 0;
+        checker[t * 4 + 1] = red ? 0 : 255;
+        checker[t * 4 + 2] = 0;
+        checker[t * 4 + 3] = 255;
+    }
+    for (bool vectorized : { false, true })
+    {
+        encodeBC7Block(checker, block, vectorized);
+        bool kept = decodeBC7Block(block, texels);
+        for (int t = 0; t < 64; ++t)
+            kept &= std::abs(texels[t] - checker[t]) <= 4;
+        if (!kept)
+            std::cout << "ERROR::TEXTURE_COMPRESSION::CHECKER: a red/green checker block lost its colors" << std::endl;
+        passed &= kept;
+    }
+
+    std::cout << "bc7 " << size << "x" << size << "\tscalar (ms)\t" << vectorColumn(textureCompressVectorized()) << " (ms)\tspeedup\tPSNR (dB)" << std::endl;
+    std::cout << "\t" << scalarMs << "\t" << vectorMs << "\t" << scalarMs / vectorMs << "x\t" << psnr << std::endl;
+    return reportCheck("texture compression", passed);
+}
+
+// Function to time the mip filters and compare the vector passes against the scalar ones
+// Builds the chain of the test image with every filter, with and without gamma. Both versions do
+// the same float operations in the same order, so their levels must match byte for byte; a flat
+// image must stay flat all the way down.
+bool checkMipChains(int size)
+{
+    const int repetitions = 3;
+    std::vector<unsigned char> rgba = microbenchImage(size);
+    bool passed = true;
+
+    std::cout << "mip chain " << size << "x" << size << "\tscalar (ms)\t" << vectorColumn(textureMipsVectorized()) << " (ms)\tspeedup" << std::endl;
+    for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+    {
+        for (bool gamma : { false, true })
+        {
+            std::vector<std::vector<unsigned char>> scalar, vector;
+            double scalarMs = microbenchMs(repetitions, [&] { scalar = buildMipChain(rgba, size, size, filter, gamma, false); });
+            double vectorMs = microbenchMs(repetitions, [&] { vector = buildMipChain(rgba, size, size, filter, gamma, true); });
+
+            const char* name = filter == MIP_FILTER_KAISER ? (gamma ? "kaiser gamma" : "kaiser") : (gamma ? "box gamma" : "box");
+            if (scalar != vector || static_cast<int>(vector.size()) != mipLevelCount(size, size) - 1)
+            {
+                std::cout << "ERROR::MIP_CHAIN::MISMATCH: " << name << std::endl;
+                passed = false;
+            }
+            std::cout << name << "\t" << scalarMs << "\t" << vectorMs << "\t" << scalarMs / vectorMs << "x" << std::endl;
+
+            std::vector<unsigned char> flat(64 * 64 * 4, 200);
+            for (const std::vector<unsigned char>& level : buildMipChain(flat, 64, 64, filter, gamma))
+                passed &= std::all_of(level.begin(), level.end(), [](unsigned char value) { return value == 200; });
+        }
+    }
+
+    return reportCheck("mip chain", passed);
+}
@@ -0,0 +1,90 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Include the frustum culling header
+#include <frustum.h>
+
+// Shared pieces of the --microbench checks: a fixed random sequence and test image so every run
+// measures the same inputs, the timing loop and the lines they print. The checks that only need
+// these live in microbench.cpp; the mesh checks stay in Source.cpp next to the scene's mesh tables.
+
+// linear congruential sequence with a fixed seed
+struct MicrobenchRandom
+{
+    unsigned int seed = 12345u;
+
+    unsigned int next()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return seed;
+    }
+
+    // uniform in [low, high) from the top 24 bits
+    float uniform(float low, float high)
+    {
+        return low + (high - low) * static_cast<float>(next() >> 8) / static_cast<float>(1u << 24);
+    }
+};
+
+// RGBA8 size x size image with a gradient in red, an 8 texel checker in green, a ramp with a little
+// noise in blue and alpha that is opaque on the top half and patterned below, rows top to bottom
+// ------------------------------------------------------------------------
+inline std::vector<unsigned char> microbenchImage(int size)
+{
+    std::vector<unsigned char> rgba(static_cast<size_t>(size) * size * 4);
+    MicrobenchRandom random;
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            unsigned char* texel = &rgba[(static_cast<size_t>(y) * size + x) * 4];
+            texel[0] = static_cast<unsigned char>(x);
+            texel[1] = static_cast<unsigned char>(((x / 8 + y / 8) % 2) ? 240 : 10);
+            texel[2] = static_cast<unsigned char>(y / 2 + (random.next() >> 28));
+            texel[3] = static_cast<unsigned char>(y < size / 2 ? 255 : x ^ y);
+        }
+    }
+    return rgba;
+}
+
+// average milliseconds of one of repetitions calls to run
+// ------------------------------------------------------------------------
+template <typename Run>
+double microbenchMs(int repetitions, Run run)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r)
+        run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+// column name of the vector version in a scalar/vector table
+// ------------------------------------------------------------------------
+inline const char* vectorColumn(bool vectorized)
+{
+    return vectorized ? "sse2" : "fallback";
+}
+
+// prints "<name> check: passed" or FAILED, returns passed
+// ------------------------------------------------------------------------
+inline bool reportCheck(const char* name, bool passed)
+{
+    std::cout << name << " check: " << (passed ? "passed" : "FAILED") << std::endl;
+    return passed;
+}
+
+// times the vector frustum test against the scalar one on boxes and spheres scattered around the
+// camera of viewProjection
+bool checkFrustumCulling(const glm::mat4& viewProjection, const MeshBounds& box, const MeshBounds& sphere);
+// times the BC7 encoder and compares the vector index search against the scalar one
+bool checkTextureCompression();
+// times the size x size mip filters and compares the vector passes against the scalar ones
+bool checkMipChains(int size);
+
+#endif
@@ -3,22 +3,59 @@ out vec4 FragColor;
 
 in vec4 ourColor;
 in vec2 TexCoord;
+flat in uint material;
 
-// Texture sampler
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+// Material images, one layer each. The array is bound to one unit per wrap mode, each unit has the
+// sampler object for its mode
+uniform sampler2DArray materialsRepeat;
+uniform sampler2DArray materialsMirroredRepeat;
+uniform sampler2DArray materialsClampToEdge;
+const int WRAP_REPEAT = 0;
+const int WRAP_MIRRORED_REPEAT = 1;
+const int WRAP_CLAMP_TO_EDGE = 2;
 
-// Speficies number of textures
-uniform int numTextures; 
+// Image layer (-1 without one) and wrap mode of each texture
+const int MAX_TEXTURES = 16;
+uniform int textureLayer[MAX_TEXTURES];
+uniform int textureWrap[MAX_TEXTURES];
 
-void main()
+// Bit per layer whose image is uploaded, the others are still streaming in and show the placeholder
+uniform uint residentLayers;
+const vec4 PLACEHOLDER_TEXEL = vec4(0.5, 0.5, 0.5, 1.0);
+
+// Material word: base texture in bits 0-7, blended texture in bits 8-15, bit 16 set when blending
+const uint MATERIAL_BLEND_BIT = 0x10000u;
+
+vec4 sampleTexture(uint id)
 {
-    if (numTextures == 1)
+    int layer = textureLayer[id];
+    if (layer < 0 || (residentLayers & (1u << uint(layer))) == 0u)
+    {
+        return PLACEHOLDER_TEXEL;
+    }
+
+    // explicit gradients, the branches below are not taken uniformly
+    vec3 coord = vec3(TexCoord, float(layer));
+    vec2 dx = dFdx(TexCoord);
+    vec2 dy = dFdy(TexCoord);
+    int wrap = textureWrap[id];
+    if (wrap == WRAP_MIRRORED_REPEAT)
     {
-        FragColor = texture(texture1, TexCoord) * ourColor;
+        return textureGrad(materialsMirroredRepeat, coord, dx, dy);
     }
-    else
+    else if (wrap == WRAP_CLAMP_TO_EDGE)
+    {
+        return textureGrad(materialsClampToEdge, coord, dx, dy);
+    }
+    return textureGrad(materialsRepeat, coord, dx, dy);
+}
+
+void main()
+{
+    vec4 color = sampleTexture(material & 0xFFu);
+    if ((material & MATERIAL_BLEND_BIT) != 0u)
     {
-        FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.5) * ourColor;
+        color = mix(color, sampleTexture((material >> 8) & 0xFFu), 0.5);
     }
+    FragColor = color * ourColor;
 }
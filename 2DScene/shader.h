@@ -3,10 +3,25 @@
 
 #include <glad/glad.h>
 
+#include <hash.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// Name of a uniform as the setters take it, a string literal or a std::string, without a copy
+struct UniformName
+{
+    const char* text;
+
+    UniformName(const char* name) : text(name) {}
+    UniformName(const std::string& name) : text(name.c_str()) {}
+};
 
 class Shader
 {
@@ -64,6 +79,8 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        // 3. look up every uniform once, the setters never ask the driver again
+        cacheUniforms();
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -74,78 +91,199 @@ public:
     {
         glUseProgram(ID);
     }
-    // utility uniform functions
+    // location of an active uniform, -1 (which the setters ignore, like GL) if the program has none
+    // by that name. Hashes the name and searches the table built after linking; no allocation and
+    // no call into the driver, but resolving a handle once is cheaper still for per-draw uniforms.
+    // ------------------------------------------------------------------------
+    int location(UniformName name) const
+    {
+        std::uint64_t hash = hashBytes(name.text, std::strlen(name.text));
+        auto entry = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+            [](const UniformEntry& e, std::uint64_t h) { return e.hash < h; });
+        for (; entry != uniforms.end() && entry->hash == hash; ++entry)
+        {
+            if (entry->name == name.text)
+                return entry->location;
+        }
+        return -1;
+    }
+    // utility uniform functions, by name or by a location from location()
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(UniformName name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setBool(location(name), value);
+    }
+    void setBool(int location, bool value) const
+    {
+        glUniform1i(location, (int)value);
     }
 
     // Set light properties
-    void setLightPosition(const std::string& name, const glm::vec3& position) const
+    void setLightPosition(UniformName name, const glm::vec3& position) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(position));
+        glUniform3fv(location(name), 1, glm::value_ptr(position));
     }
 
-    void setLightColor(const std::string& name, const glm::vec3& color) const
+    void setLightColor(UniformName name, const glm::vec3& color) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(color));
+        glUniform3fv(location(name), 1, glm::value_ptr(color));
     }
 
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(UniformName name, int value) const
+    {
+        setInt(location(name), value);
+    }
+    void setInt(int location, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setUInt(UniformName name, unsigned int value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setUInt(location(name), value);
+    }
+    void setUInt(int location, unsigned int value) const
+    {
+        glUniform1ui(location, value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setFloat(UniformName name, float value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setFloat(location(name), value);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setFloat(int location, float value) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec2(UniformName name, const glm::vec2& value) const
+    {
+        setVec2(location(name), value);
+    }
+    void setVec2(int location, const glm::vec2& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(location, 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec2(UniformName name, float x, float y) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec2(location(name), x, y);
+    }
+    void setVec2(int location, float x, float y) const
+    {
+        glUniform2f(location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec3(UniformName name, const glm::vec3& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(location(name), value);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec3(int location, const glm::vec3& value) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform3fv(location, 1, &value[0]);
+    }
+    void setVec3(UniformName name, float x, float y, float z) const
+    {
+        setVec3(location(name), x, y, z);
+    }
+    void setVec3(int location, float x, float y, float z) const
+    {
+        glUniform3f(location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setVec4(UniformName name, const glm::vec4& value) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setVec4(location(name), value);
+    }
+    void setVec4(int location, const glm::vec4& value) const
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+    void setVec4(UniformName name, float x, float y, float z, float w) const
+    {
+        setVec4(location(name), x, y, z, w);
+    }
+    void setVec4(int location, float x, float y, float z, float w) const
+    {
+        glUniform4f(location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat2(UniformName name, const glm::mat2& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(location(name), mat);
+    }
+    void setMat2(int location, const glm::mat2& mat) const
+    {
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat3(UniformName name, const glm::mat3& mat) const
+    {
+        setMat3(location(name), mat);
+    }
+    void setMat3(int location, const glm::mat3& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(UniformName name, const glm::mat4& mat) const
+    {
+        setMat4(location(name), mat);
+    }
+    void setMat4(int location, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // one active uniform; array elements have an entry each, and the bare array name is element 0
+    struct UniformEntry
+    {
+        std::uint64_t hash;
+        int location;
+        std::string name;
+    };
+    // sorted by hash
+    std::vector<UniformEntry> uniforms;
+
+    // fills the uniform table from the linked program's active uniforms
+    // ------------------------------------------------------------------------
+    void cacheUniforms()
+    {
+        int count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> nameBuffer(std::max(maxLength, 1));
+        for (int i = 0; i < count; ++i)
+        {
+            int length = 0, size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            // members of uniform blocks have no location
+            if (glGetUniformLocation(ID, name.c_str()) < 0)
+                continue;
+
+            // arrays are reported once as "name[0]" with their element count
+            std::string::size_type bracket = name.find('[');
+            if (bracket == std::string::npos)
+            {
+                addUniform(name);
+                continue;
+            }
+            std::string base = name.substr(0, bracket);
+            addUniform(base);
+            for (int element = 0; element < size; ++element)
+                addUniform(base + "[" + std::to_string(element) + "]");
+        }
+        std::sort(uniforms.begin(), uniforms.end(), [](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+    }
+
+    void addUniform(const std::string& name)
+    {
+        uniforms.push_back({ hashBytes(name.data(), name.size()), glGetUniformLocation(ID, name.c_str()), name });
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
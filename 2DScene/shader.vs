@@ -2,18 +2,133 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec4 aColor;
 layout (location = 2) in vec2 aTexCoord;
+// Every draw reads its transform and material from the instance buffer, a single draw is one instance
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in uint aMaterial;
 
 out vec4 ourColor;
 out vec2 TexCoord;
+flat out uint material;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Camera and light of the frame, binding 0 is FRAME_UNIFORM_BINDING
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	vec4 lightPosition;
+	vec4 lightColor;
+};
 
-void main()
+// Vertex pulling: with shape set, the vertex is computed from gl_VertexID and these parameters and
+// the vertex attributes are not read. Layouts and texture coordinates match the CPU generators.
+uniform int shape;          // 0 reads the attributes, otherwise a ProceduralShape value
+uniform int sides;          // sides of cylinders, caps and cones, rings and segments of spheres
+uniform float height;
+uniform float radius;
+uniform vec4 shapeColor;
+
+const int SHAPE_CYLINDER_SIDE = 1;
+const int SHAPE_CYLINDER_TOP = 2;
+const int SHAPE_CYLINDER_BOTTOM = 3;
+const int SHAPE_SPHERE = 4;
+const int SHAPE_CONE = 5;
+
+const float PI = 3.14159265358979323846;
+
+// point i of the unit circle with the given number of sides
+vec2 ringPoint(int i)
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0f);
-	ourColor = aColor;
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+	float angle = float(i) * (2.0 * PI / float(sides));
+	return vec2(cos(angle), sin(angle));
 }
 
+// position and texture coordinate of vertex gl_VertexID of a non-indexed triangle list
+void pullVertex(out vec3 position, out vec2 texCoord)
+{
+	int id = gl_VertexID;
+	float halfHeight = height / 2.0;
+
+	if (shape == SHAPE_CYLINDER_SIDE)
+	{
+		// two triangles per side: current, next, next top, next top, current top, current
+		int side = id / 6;
+		int corner = id % 6;
+		int i = (corner >= 1 && corner <= 3) ? (side + 1) % sides : side;
+		bool top = corner >= 2 && corner <= 4;
+		vec2 point = ringPoint(i);
+		position = vec3(radius * point.x, top ? halfHeight : -halfHeight, radius * point.y);
+		texCoord = vec2(float(i) / float(sides), top ? 1.0 : 0.0);
+	}
+	else if (shape == SHAPE_CYLINDER_TOP || shape == SHAPE_CYLINDER_BOTTOM)
+	{
+		// fan: current, next, center
+		int side = id / 3;
+		int corner = id % 3;
+		float y = shape == SHAPE_CYLINDER_TOP ? halfHeight : -halfHeight;
+		if (corner == 2)
+		{
+			position = vec3(0.0, y, 0.0);
+			texCoord = vec2(0.5);
+		}
+		else
+		{
+			vec2 point = ringPoint((side + corner) % sides);
+			position = vec3(radius * point.x, y, radius * point.y);
+			texCoord = 0.5 + 0.5 * point;
+		}
+	}
+	else if (shape == SHAPE_SPHERE)
+	{
+		// two triangles per quad: current, next ring, current + 1, current + 1, next ring, next ring + 1
+		const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+		int quad = id / 6;
+		ivec2 corner = corners[id % 6];
+		int ring = quad / sides + corner.x;
+		int segment = quad % sides + corner.y;
+		float phi = PI * float(ring) / float(sides);
+		float theta = 2.0 * PI * float(segment) / float(sides);
+		position = radius * vec3(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi));
+		texCoord = vec2(float(segment) / float(sides), float(ring) / float(sides));
+	}
+	else
+	{
+		// cone: a base and a side triangle per side, then the base again with cap coordinates
+		int side = id < sides * 6 ? id / 6 : (id - sides * 6) / 3;
+		int corner = id < sides * 6 ? id % 6 : (id - sides * 6) % 3;
+		bool capPass = id >= sides * 6;
+		vec2 point = ringPoint(side + (corner == 1 || corner == 4 ? 1 : 0));
+		if (corner == 2)
+		{
+			position = vec3(0.0, -halfHeight, 0.0);
+			texCoord = vec2(0.5);
+		}
+		else if (corner == 5)
+		{
+			position = vec3(0.0, halfHeight, 0.0);
+			texCoord = vec2(0.5, 1.0);
+		}
+		else
+		{
+			position = vec3(radius * point.x, -halfHeight, radius * point.y);
+			float u = capPass ? 0.5 + 0.5 * point.x : float(side + (corner == 1 || corner == 4 ? 1 : 0)) / float(sides - 1);
+			texCoord = vec2(u, 0.0);
+		}
+	}
+}
+
+void main()
+{
+	vec3 position = aPos;
+	vec4 color = aColor;
+	vec2 texCoord = aTexCoord;
+	if (shape != 0)
+	{
+		pullVertex(position, texCoord);
+		color = shapeColor;
+	}
+
+	gl_Position = projection * view * aInstanceModel * vec4(position, 1.0f);
+	material = aMaterial;
+	ourColor = color;
+	TexCoord = vec2(texCoord.x, texCoord.y);
+}
@@ -0,0 +1,12 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is part of every x64 target, so the vector paths of the mesh kernels, the frustum culler,
+// the mip filters and the BC7 encoder need no extra compiler flags. Define SCENE_NO_SIMD to force
+// the scalar fallback in all of them at once.
+#if !defined(SCENE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SCENE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef STATIC_MESH_H
+#define STATIC_MESH_H
+
+#include <array>
+#include <cstddef>
+
+// constexpr versions of the cylinder, cap, sphere and cone generators. With the resolution as a
+// template parameter the compiler evaluates them into std::arrays that live in the binary's
+// read-only data, so a fixed-resolution scene uploads its meshes without any runtime math or
+// allocation. Layouts and vertex order match the runtime generators exactly, which also makes
+// these tables a reference to check the runtime generators against. The 64-sided sphere takes
+// more constant evaluation steps than clang and MSVC allow by default, so CMakeLists.txt and
+// 2DScene.vcxproj raise the limit.
+
+// sin/cos the compiler can evaluate (Taylor series in double, |x| is reduced to pi first)
+// ------------------------------------------------------------------------
+constexpr double staticSinCosSeries(double x, bool cosine)
+{
+    const double pi = 3.14159265358979323846;
+    while (x > pi)
+        x -= 2.0 * pi;
+    while (x < -pi)
+        x += 2.0 * pi;
+
+    double term = cosine ? 1.0 : x;
+    double sum = term;
+    for (int n = 2; n < 36; n += 2)
+    {
+        // next term of the series: x^(n+1) / (n+1)! for sin, x^n / n! for cos, alternating sign
+        term *= -x * x / (cosine ? (n - 1) * n : n * (n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr float staticSin(float x)
+{
+    return static_cast<float>(staticSinCosSeries(x, false));
+}
+
+constexpr float staticCos(float x)
+{
+    return static_cast<float>(staticSinCosSeries(x, true));
+}
+
+// writes one 9 float vertex (position, color, texture coordinate) into a table
+template <size_t N>
+constexpr void setStaticVertex(std::array<float, N>& table, size_t vertex, float x, float y, float z,
+    const std::array<float, 4>& rgba, float u, float v)
+{
+    size_t base = vertex * 9;
+    table[base + 0] = x;
+    table[base + 1] = y;
+    table[base + 2] = z;
+    table[base + 3] = rgba[0];
+    table[base + 4] = rgba[1];
+    table[base + 5] = rgba[2];
+    table[base + 6] = rgba[3];
+    table[base + 7] = u;
+    table[base + 8] = v;
+}
+
+// same angle spacing as TrigRingCache
+template <int Sides>
+constexpr float staticRingAngle(int i)
+{
+    return i * (2.0f * 3.14159265358979323846f / Sides);
+}
+
+// cylinder wall: bottom ring then top ring, like genCylSideVerts
+// ------------------------------------------------------------------------
+template <int Sides>
+constexpr std::array<float, Sides * 2 * 9> makeCylinderSideVertices(float height, float radius, std::array<float, 4> rgba)
+{
+    std::array<float, Sides * 2 * 9> vertices{};
+    float halfHeight = height / 2.0f;
+    for (int i = 0; i < Sides; ++i)
+    {
+        float x = radius * staticCos(staticRingAngle<Sides>(i));
+        float z = radius * staticSin(staticRingAngle<Sides>(i));
+        float u = static_cast<float>(i) / static_cast<float>(Sides);
+        setStaticVertex(vertices, i, x, -halfHeight, z, rgba, u, 0.0f);
+        setStaticVertex(vertices, Sides + i, x, halfHeight, z, rgba, u, 1.0f);
+    }
+    return vertices;
+}
+
+// cylinder cap at height y: rim then center, like genCylTopVerts/genCylBottomVerts
+// ------------------------------------------------------------------------
+template <int Sides>
+constexpr std::array<float, (Sides + 1) * 9> makeCapVertices(float y, float radius, std::array<float, 4> rgba)
+{
+    std::array<float, (Sides + 1) * 9> vertices{};
+    for (int i = 0; i < Sides; ++i)
+    {
+        float c = staticCos(staticRingAngle<Sides>(i));
+        float s = staticSin(staticRingAngle<Sides>(i));
+        setStaticVertex(vertices, i, radius * c, y, radius * s, rgba, 0.5f + 0.5f * c, 0.5f + 0.5f * s);
+    }
+    setStaticVertex(vertices, Sides, 0.0f, y, 0.0f, rgba, 0.5f, 0.5f);
+    return vertices;
+}
+
+template <int Sides>
+constexpr std::array<unsigned int, Sides * 6> makeCylinderSideIndices()
+{
+    std::array<unsigned int, Sides * 6> indices{};
+    for (int i = 0; i < Sides; ++i)
+    {
+        unsigned int current = i;
+        unsigned int next = (i + 1) % Sides;
+        indices[i * 6 + 0] = current;
+        indices[i * 6 + 1] = next;
+        indices[i * 6 + 2] = next + Sides;
+        indices[i * 6 + 3] = next + Sides;
+        indices[i * 6 + 4] = current + Sides;
+        indices[i * 6 + 5] = current;
+    }
+    return indices;
+}
+
+// triangle fan around the center vertex, used for both caps
+template <int Sides>
+constexpr std::array<unsigned int, Sides * 3> makeCapIndices()
+{
+    std::array<unsigned int, Sides * 3> indices{};
+    for (int i = 0; i < Sides; ++i)
+    {
+        indices[i * 3 + 0] = i;
+        indices[i * 3 + 1] = (i + 1) % Sides;
+        indices[i * 3 + 2] = Sides;
+    }
+    return indices;
+}
+
+// UV sphere around the z axis, like genSphereVerts
+// ------------------------------------------------------------------------
+template <int Rings, int Segments>
+constexpr std::array<float, (Rings + 1) * (Segments + 1) * 9> makeSphereVertices(float radius, std::array<float, 4> rgba)
+{
+    const float pi = 3.14159265358979323846f;
+
+    // one sin/cos per ring and per segment keeps the evaluation within compiler step limits
+    std::array<float, Rings + 1> sinPhi{}, cosPhi{};
+    for (int i = 0; i <= Rings; ++i)
+    {
+        float phi = pi * i / Rings;
+        sinPhi[i] = staticSin(phi);
+        cosPhi[i] = staticCos(phi);
+    }
+    std::array<float, Segments + 1> sinTheta{}, cosTheta{};
+    for (int j = 0; j <= Segments; ++j)
+    {
+        float theta = (2 * pi) * j / Segments;
+        sinTheta[j] = staticSin(theta);
+        cosTheta[j] = staticCos(theta);
+    }
+
+    std::array<float, (Rings + 1) * (Segments + 1) * 9> vertices{};
+    for (int i = 0; i <= Rings; ++i)
+    {
+        for (int j = 0; j <= Segments; ++j)
+        {
+            setStaticVertex(vertices, i * (Segments + 1) + j,
+                radius * sinPhi[i] * cosTheta[j],
+                radius * sinPhi[i] * sinTheta[j],
+                radius * cosPhi[i],
+                rgba, static_cast<float>(j) / Segments, static_cast<float>(i) / Rings);
+        }
+    }
+    return vertices;
+}
+
+template <int Rings, int Segments>
+constexpr std::array<unsigned int, Rings * Segments * 6> makeSphereIndices()
+{
+    std::array<unsigned int, Rings * Segments * 6> indices{};
+    size_t n = 0;
+    for (int i = 0; i < Rings; ++i)
+    {
+        for (int j = 0; j < Segments; ++j)
+        {
+            unsigned int current = i * (Segments + 1) + j;
+            unsigned int next = current + Segments + 1;
+            indices[n++] = current;
+            indices[n++] = next;
+            indices[n++] = current + 1;
+            indices[n++] = current + 1;
+            indices[n++] = next;
+            indices[n++] = next + 1;
+        }
+    }
+    return indices;
+}
+
+// cone as a triangle soup: base and side triangle per side, then the base again, like genPyramidVerts
+// ------------------------------------------------------------------------
+template <int Sides>
+constexpr std::array<float, Sides * 9 * 9> makeConeVertices(float height, float radius, std::array<float, 4> rgba)
+{
+    std::array<float, Sides * 9 * 9> vertices{};
+    float halfHeight = height / 2.0f;
+    size_t n = 0;
+    for (int i = 0; i < Sides; ++i)
+    {
+        float x1 = radius * staticCos(staticRingAngle<Sides>(i));
+        float z1 = radius * staticSin(staticRingAngle<Sides>(i));
+        float x2 = radius * staticCos(staticRingAngle<Sides>(i + 1));
+        float z2 = radius * staticSin(staticRingAngle<Sides>(i + 1));
+        float u1 = static_cast<float>(i) / static_cast<float>(Sides - 1);
+        float u2 = static_cast<float>(i + 1) / static_cast<float>(Sides - 1);
+
+        setStaticVertex(vertices, n++, x1, -halfHeight, z1, rgba, u1, 0.0f);
+        setStaticVertex(vertices, n++, x2, -halfHeight, z2, rgba, u2, 0.0f);
+        setStaticVertex(vertices, n++, 0.0f, -halfHeight, 0.0f, rgba, 0.5f, 0.5f);
+
+        setStaticVertex(vertices, n++, x1, -halfHeight, z1, rgba, u1, 0.0f);
+        setStaticVertex(vertices, n++, x2, -halfHeight, z2, rgba, u2, 0.0f);
+        setStaticVertex(vertices, n++, 0.0f, halfHeight, 0.0f, rgba, 0.5f, 1.0f);
+    }
+    for (int i = 0; i < Sides; ++i)
+    {
+        float c1 = staticCos(staticRingAngle<Sides>(i));
+        float c2 = staticCos(staticRingAngle<Sides>(i + 1));
+        setStaticVertex(vertices, n++, radius * c1, -halfHeight, radius * staticSin(staticRingAngle<Sides>(i)), rgba, 0.5f + 0.5f * c1, 0.0f);
+        setStaticVertex(vertices, n++, radius * c2, -halfHeight, radius * staticSin(staticRingAngle<Sides>(i + 1)), rgba, 0.5f + 0.5f * c2, 0.0f);
+        setStaticVertex(vertices, n++, 0.0f, -halfHeight, 0.0f, rgba, 0.5f, 0.5f);
+    }
+    return vertices;
+}
+
+// 0, 1, 2, ... for triangle soups
+template <size_t Count>
+constexpr std::array<unsigned int, Count> makeSequentialIndices()
+{
+    std::array<unsigned int, Count> indices{};
+    for (size_t i = 0; i < Count; ++i)
+        indices[i] = static_cast<unsigned int>(i);
+    return indices;
+}
+#endif
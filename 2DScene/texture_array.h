@@ -0,0 +1,293 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+
+#include <texture_compress.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Material images as the layers of one GL_TEXTURE_2D_ARRAY. Every image is resampled to the
+// array's size and stored with its mip chain as RGBA8, or as BC7 when it was compressed ahead of
+// time, so a single bind covers every material and draws with different textures can share a
+// batch. A texture is an image layer plus a wrap mode, a draw picks its textures through the
+// material word in its instance data.
+
+// Largest number of layers residentLayers in shader.fs has bits for
+const int MAX_TEXTURE_LAYERS = 16;
+// Largest number of textures shader.fs has layers and wrap modes for
+const int MAX_TEXTURES = 16;
+static_assert(MAX_TEXTURES <= MAX_TEXTURE_LAYERS, "every texture can have an image of its own");
+
+// Material word, read by shader.fs: the base texture in bits 0-7, the texture blended over it in
+// bits 8-15 and MATERIAL_BLEND_BIT when the second texture is used
+const unsigned int MATERIAL_BLEND_BIT = 1u << 16;
+
+// material that samples one texture
+constexpr unsigned int packMaterial(unsigned int texture)
+{
+    return texture;
+}
+
+// material that mixes two textures half and half
+constexpr unsigned int packMaterial(unsigned int texture, unsigned int blendTexture)
+{
+    return texture | (blendTexture << 8) | MATERIAL_BLEND_BIT;
+}
+
+// Wrap mode of a texture, the values are shared with shader.fs. The array is bound to the texture
+// unit of each mode's number with that mode's sampler object.
+enum TextureWrap
+{
+    WRAP_REPEAT,
+    WRAP_MIRRORED_REPEAT,
+    WRAP_CLAMP_TO_EDGE,
+    WRAP_COUNT
+};
+
+// one pass of a separable tent filter: resamples count rows of `channels` floats from sourceSize to
+// targetSize texels, where texels of a row are `stride` floats apart. Downscaling widens the tent to
+// the size of a target texel so every source texel contributes; upscaling is bilinear.
+// ------------------------------------------------------------------------
+inline void resampleRows(const std::vector<float>& source, std::vector<float>& target, int sourceSize, int targetSize,
+    int count, int sourceRowStride, int targetRowStride, int stride, int channels)
+{
+    float scale = static_cast<float>(sourceSize) / targetSize;
+    float support = std::max(scale, 1.0f);
+    std::vector<float> weights;
+    for (int t = 0; t < targetSize; ++t)
+    {
+        float center = (t + 0.5f) * scale - 0.5f;
+        int first = std::max(0, static_cast<int>(std::floor(center - support)) + 1);
+        int last = std::min(sourceSize - 1, static_cast<int>(std::ceil(center + support)) - 1);
+        // weights of this target texel, the same for every row
+        weights.clear();
+        float total = 0.0f;
+        for (int s = first; s <= last; ++s)
+        {
+            weights.push_back(std::max(0.0f, 1.0f - std::fabs(s - center) / support));
+            total += weights.back();
+        }
+        if (total <= 0.0f)
+        {
+            // center falls outside the image, use the nearest edge texel
+            first = last = std::min(std::max(static_cast<int>(std::lround(center)), 0), sourceSize - 1);
+            weights.assign(1, 1.0f);
+            total = 1.0f;
+        }
+
+        for (int row = 0; row < count; ++row)
+        {
+            const float* in = &source[row * sourceRowStride];
+            float* out = &target[row * targetRowStride + t * stride];
+            for (int c = 0; c < channels; ++c)
+            {
+                float sum = 0.0f;
+                for (int s = first; s <= last; ++s)
+                    sum += in[s * stride + c] * weights[s - first];
+                out[c] = sum / total;
+            }
+        }
+    }
+}
+
+// converts 3 or 4 channel pixels to RGBA8 at targetWidth x targetHeight
+// ------------------------------------------------------------------------
+inline std::vector<unsigned char> resampleToRGBA(const unsigned char* pixels, int width, int height, int channels, int targetWidth, int targetHeight)
+{
+    std::vector<float> source(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+            source[i * 4 + c] = pixels[i * channels + c];
+        source[i * 4 + 3] = channels == 4 ? pixels[i * channels + 3] : 255.0f;
+    }
+
+    // horizontal then vertical; a column is a "row" of texels one image row apart
+    std::vector<float> wide(static_cast<size_t>(targetWidth) * height * 4);
+    resampleRows(source, wide, width, targetWidth, height, width * 4, targetWidth * 4, 4, 4);
+    std::vector<float> target(static_cast<size_t>(targetWidth) * targetHeight * 4);
+    resampleRows(wide, target, height, targetHeight, targetWidth, 4, 4, targetWidth * 4, 4);
+
+    std::vector<unsigned char> rgba(target.size());
+    for (size_t i = 0; i < target.size(); ++i)
+        rgba[i] = static_cast<unsigned char>(std::min(std::max(target[i] + 0.5f, 0.0f), 255.0f));
+    return rgba;
+}
+
+// The array texture
+class TextureArray
+{
+public:
+    unsigned int ID;
+
+    TextureArray() : ID(0), arrayWidth(0), arrayHeight(0), arrayLayers(0), arrayLevels(0), compressed(false)
+    {
+    }
+
+    // allocates immutable storage for layerCount layers of width x height RGBA8 texels with
+    // levelCount mip levels, empty until setLevel()
+    // ------------------------------------------------------------------------
+    void create(int width, int height, int layerCount, int levelCount)
+    {
+        arrayWidth = width;
+        arrayHeight = height;
+        arrayLayers = layerCount;
+        arrayLevels = levelCount;
+        compressed = false;
+
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_RGBA8, width, height, layerCount);
+    }
+
+    // stores RGBA8 pixels of a mip level's size in a layer, see resampleToRGBA() and buildMipChain()
+    void setLevel(int layer, int level, const unsigned char* rgba)
+    {
+        setRows(layer, level, 0, levelHeight(level), rgba);
+    }
+
+    // stores rowCount full rows of a layer's mip level starting at firstRow. With a
+    // GL_PIXEL_UNPACK_BUFFER bound rgba is an offset into that buffer.
+    // ------------------------------------------------------------------------
+    void setRows(int layer, int level, int firstRow, int rowCount, const void* rgba)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, firstRow, layer, levelWidth(level), rowCount, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+
+    // allocates immutable BC7 storage for layerCount layers with levelCount mip levels, empty until
+    // setCompressedLevel()
+    // ------------------------------------------------------------------------
+    void createCompressed(int width, int height, int layerCount, int levelCount)
+    {
+        arrayWidth = width;
+        arrayHeight = height;
+        arrayLayers = layerCount;
+        arrayLevels = levelCount;
+        compressed = true;
+
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_COMPRESSED_RGBA_BPTC_UNORM, width, height, layerCount);
+    }
+
+    // stores the BC7 blocks of one mip level of a layer, see encodeBC7Rows()
+    // ------------------------------------------------------------------------
+    void setCompressedLevel(int layer, int level, const std::vector<unsigned char>& blocks)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth(level), levelHeight(level), 1,
+            GL_COMPRESSED_RGBA_BPTC_UNORM, static_cast<GLsizei>(blocks.size()), blocks.data());
+    }
+
+    // texel memory of every layer and level
+    // ------------------------------------------------------------------------
+    size_t byteCount() const
+    {
+        size_t bytes = 0;
+        for (int level = 0; level < arrayLevels; ++level)
+        {
+            int width = levelWidth(level), height = levelHeight(level);
+            bytes += compressed ? bc7LevelBytes(width, height) : static_cast<size_t>(width) * height * 4;
+        }
+        return bytes * arrayLayers;
+    }
+
+    bool isCompressed() const
+    {
+        return compressed;
+    }
+
+    int width() const
+    {
+        return arrayWidth;
+    }
+
+    int height() const
+    {
+        return arrayHeight;
+    }
+
+    int levelWidth(int level) const
+    {
+        return std::max(arrayWidth >> level, 1);
+    }
+
+    int levelHeight(int level) const
+    {
+        return std::max(arrayHeight >> level, 1);
+    }
+
+    int levels() const
+    {
+        return arrayLevels;
+    }
+
+    // deletes the GL texture
+    void release()
+    {
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+
+private:
+    int arrayWidth;
+    int arrayHeight;
+    int arrayLayers;
+    int arrayLevels;
+    bool compressed;
+};
+
+// One sampler object per wrap mode, each bound to the texture unit of its mode's number. A sampler
+// replaces the sampling state of whatever texture is bound to its unit, so one image can be
+// repeated on one object and clamped on another without a second copy.
+class TextureSamplers
+{
+public:
+    unsigned int samplers[WRAP_COUNT];
+
+    TextureSamplers() : samplers()
+    {
+    }
+
+    // creates the samplers and binds them to units 0 .. WRAP_COUNT - 1 for the rest of the run.
+    // Minification blends between the two closest mip levels.
+    // ------------------------------------------------------------------------
+    void create()
+    {
+        const GLint modes[WRAP_COUNT] = { GL_REPEAT, GL_MIRRORED_REPEAT, GL_CLAMP_TO_EDGE };
+        glGenSamplers(WRAP_COUNT, samplers);
+        for (int wrap = 0; wrap < WRAP_COUNT; ++wrap)
+        {
+            glSamplerParameteri(samplers[wrap], GL_TEXTURE_WRAP_S, modes[wrap]);
+            glSamplerParameteri(samplers[wrap], GL_TEXTURE_WRAP_T, modes[wrap]);
+            glSamplerParameteri(samplers[wrap], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glSamplerParameteri(samplers[wrap], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindSampler(wrap, samplers[wrap]);
+        }
+    }
+
+    // binds a texture to every unit, so each wrap mode samples it
+    void bind(GLenum target, unsigned int texture) const
+    {
+        for (int wrap = 0; wrap < WRAP_COUNT; ++wrap)
+        {
+            glActiveTexture(GL_TEXTURE0 + wrap);
+            glBindTexture(target, texture);
+        }
+    }
+
+    // deletes the GL samplers
+    void release()
+    {
+        for (int wrap = 0; wrap < WRAP_COUNT; ++wrap)
+            glBindSampler(wrap, 0);
+        glDeleteSamplers(WRAP_COUNT, samplers);
+        for (unsigned int& sampler : samplers)
+            sampler = 0;
+    }
+};
+#endif
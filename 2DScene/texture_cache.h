@@ -0,0 +1,58 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Distinct images behind the scene's textures, keyed by a hash of the file contents and the decode
+// settings. Textures that resolve to the same key share one image, so it is decoded once and takes
+// one layer of the material array; they differ only in the sampler they are read through.
+
+class TextureCache
+{
+public:
+    // image of key, a new one numbered in order of first use when the key has not been seen;
+    // added tells which
+    // ------------------------------------------------------------------------
+    int acquire(std::uint64_t key, bool& added)
+    {
+        // a scene has a handful of images, a linear search beats hashing again
+        for (size_t image = 0; image < keys.size(); ++image)
+        {
+            if (keys[image] == key)
+            {
+                added = false;
+                return static_cast<int>(image);
+            }
+        }
+        keys.push_back(key);
+        added = true;
+        return static_cast<int>(keys.size() - 1);
+    }
+
+    int imageCount() const
+    {
+        return static_cast<int>(keys.size());
+    }
+
+    void clear()
+    {
+        keys.clear();
+    }
+
+private:
+    std::vector<std::uint64_t> keys;
+};
+
+// reads a whole file, false when it cannot be opened
+inline bool readFileBytes(const char* path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+#endif
@@ -0,0 +1,481 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Include the SIMD detection header
+#include <simd.h>
+
+// BC7 block compression of the material images and the DDS files they are kept in. --compress-textures
+// encodes every image with its full mip chain ahead of time; at startup the files are uploaded as
+// they are (GL_COMPRESSED_RGBA_BPTC_UNORM, core since OpenGL 4.2), a byte per texel instead of four
+// and no JPEG or PNG decode. Blocks use mode 6 only: one RGBA line with 16 steps per 4x4 block.
+
+const int BC7_BLOCK_BYTES = 16;
+// Bump when the encoder changes, older files are then ignored
+const std::uint32_t COMPRESSED_TEXTURE_VERSION = 2;
+
+// 4 bit interpolation weights of the BC7 specification, out of 64
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// bytes of a level of width x height texels, partial blocks count as whole ones
+inline size_t bc7LevelBytes(int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BC7_BLOCK_BYTES;
+}
+
+// number of levels from width x height down to 1x1
+inline int mipLevelCount(int width, int height)
+{
+    int levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        ++levels;
+    }
+    return levels;
+}
+
+// Writes fields into a 128 bit block, least significant bit first
+struct BlockBitWriter
+{
+    unsigned char* bytes;
+    int position;
+
+    void write(unsigned int value, int bits)
+    {
+        for (int i = 0; i < bits; ++i, ++position)
+        {
+            if (value & (1u << i))
+                bytes[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+        }
+    }
+};
+
+// Reads fields from a 128 bit block, least significant bit first
+struct BlockBitReader
+{
+    const unsigned char* bytes;
+    int position;
+
+    unsigned int read(int bits)
+    {
+        unsigned int value = 0;
+        for (int i = 0; i < bits; ++i, ++position)
+            value |= ((bytes[position >> 3] >> (position & 7)) & 1u) << i;
+        return value;
+    }
+};
+
+// Mode 6 endpoints: 7 bits per channel plus one shared low bit each, and the 16 colors between them
+struct BC7Endpoints
+{
+    int color[2][4];
+    int pBit[2];
+    int palette[16][4];
+};
+
+// quantizes a float endpoint to 7 bits plus a p-bit, picking the p-bit with the smaller error
+inline void quantizeEndpoint(const float value[4], int color[4], int& pBit)
+{
+    float bestError = 0.0f;
+    for (int p = 0; p < 2; ++p)
+    {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            int q = static_cast<int>(std::lround((value[c] - p) / 2.0f));
+            candidate[c] = std::min(std::max(q, 0), 127);
+            float d = static_cast<float>((candidate[c] << 1) | p) - value[c];
+            error += d * d;
+        }
+        if (p == 0 || error < bestError)
+        {
+            bestError = error;
+            pBit = p;
+            std::memcpy(color, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// fills in the 16 interpolated colors
+inline void buildPalette(BC7Endpoints& endpoints)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            int e0 = (endpoints.color[0][c] << 1) | endpoints.pBit[0];
+            int e1 = (endpoints.color[1][c] << 1) | endpoints.pBit[1];
+            endpoints.palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+        }
+    }
+}
+
+// picks the closest palette entry of every texel, one texel at a time
+// ------------------------------------------------------------------------
+inline void selectIndicesScalar(const unsigned char texels[64], const BC7Endpoints& endpoints, int indices[16])
+{
+    for (int t = 0; t < 16; ++t)
+    {
+        int bestError = 0x7fffffff;
+        for (int i = 0; i < 16; ++i)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int d = texels[t * 4 + c] - endpoints.palette[i][c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[t] = i;
+            }
+        }
+    }
+}
+
+#ifdef SCENE_SSE2
+// picks the closest palette entry of four texels at once, the channels laid out one register each.
+// The errors are exact integers in float, so the choices match the scalar version.
+// ------------------------------------------------------------------------
+inline void selectIndicesSSE2(const unsigned char texels[64], const BC7Endpoints& endpoints, int indices[16])
+{
+    for (int group = 0; group < 4; ++group)
+    {
+        const unsigned char* t = texels + group * 16;
+        __m128 channel[4];
+        for (int c = 0; c < 4; ++c)
+            channel[c] = _mm_set_ps(t[12 + c], t[8 + c], t[4 + c], t[c]);
+
+        __m128 bestError = _mm_set1_ps(3.0e38f);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int i = 0; i < 16; ++i)
+        {
+            __m128 error = _mm_setzero_ps();
+            for (int c = 0; c < 4; ++c)
+            {
+                __m128 d = _mm_sub_ps(channel[c], _mm_set1_ps(static_cast<float>(endpoints.palette[i][c])));
+                error = _mm_add_ps(error, _mm_mul_ps(d, d));
+            }
+            // strictly smaller keeps the first of equal entries, like the scalar loop
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestError = _mm_min_ps(error, bestError);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)), _mm_andnot_si128(closer, bestIndex));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + group * 4), bestIndex);
+    }
+}
+#endif
+
+// true when the vector index search is compiled in
+inline bool textureCompressVectorized()
+{
+#ifdef SCENE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+// refines axis towards the principal axis of a 4x4 covariance matrix by power iteration. Returns
+// false, leaving axis as it was, when the first step collapses to zero (axis orthogonal to the spread).
+// ------------------------------------------------------------------------
+inline bool principalAxis(const float covariance[4][4], float axis[4])
+{
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int a = 0; a < 4; ++a)
+            for (int b = 0; b < 4; ++b)
+                next[a] += covariance[a][b] * axis[b];
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1.0e-6f)
+            return iteration > 0;
+        for (int c = 0; c < 4; ++c)
+            axis[c] = next[c] / length;
+    }
+    return true;
+}
+
+// encodes one 4x4 block of RGBA8 texels (row by row) as BC7 mode 6. The endpoints are the extremes
+// of the texels along their principal axis.
+// ------------------------------------------------------------------------
+inline void encodeBC7Block(const unsigned char texels[64], unsigned char block[BC7_BLOCK_BYTES], bool vectorized = true)
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; ++t)
+        for (int c = 0; c < 4; ++c)
+            mean[c] += texels[t * 4 + c];
+    for (int c = 0; c < 4; ++c)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (int t = 0; t < 16; ++t)
+    {
+        float d[4];
+        for (int c = 0; c < 4; ++c)
+            d[c] = texels[t * 4 + c] - mean[c];
+        for (int a = 0; a < 4; ++a)
+            for (int b = 0; b < 4; ++b)
+                covariance[a][b] += d[a] * d[b];
+    }
+
+    // power iteration from the diagonal finds the principal axis in a few steps. Anti-correlated
+    // channels (a red/green checker) cancel the diagonal out, so start again from the widest channel,
+    // which the covariance never maps to zero; a flat block keeps that unit axis and projects to 0
+    float axis[4] = { covariance[0][0], covariance[1][1], covariance[2][2], covariance[3][3] };
+    if (!principalAxis(covariance, axis))
+    {
+        int widest = 0;
+        for (int c = 1; c < 4; ++c)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        for (int c = 0; c < 4; ++c)
+            axis[c] = c == widest ? 1.0f : 0.0f;
+        principalAxis(covariance, axis);
+    }
+
+    float low = 0.0f, high = 0.0f;
+    for (int t = 0; t < 16; ++t)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < 4; ++c)
+            projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+        low = std::min(low, projection);
+        high = std::max(high, projection);
+    }
+
+    BC7Endpoints endpoints;
+    for (int e = 0; e < 2; ++e)
+    {
+        float value[4];
+        for (int c = 0; c < 4; ++c)
+            value[c] = std::min(std::max(mean[c] + (e == 0 ? low : high) * axis[c], 0.0f), 255.0f);
+        quantizeEndpoint(value, endpoints.color[e], endpoints.pBit[e]);
+    }
+    buildPalette(endpoints);
+
+    int indices[16];
+#ifdef SCENE_SSE2
+    if (vectorized)
+        selectIndicesSSE2(texels, endpoints, indices);
+    else
+        selectIndicesScalar(texels, endpoints, indices);
+#else
+    (void)vectorized;
+    selectIndicesScalar(texels, endpoints, indices);
+#endif
+
+    // the first index is stored with 3 bits, swapping the endpoints keeps its top bit clear
+    if (indices[0] & 8)
+    {
+        for (int c = 0; c < 4; ++c)
+            std::swap(endpoints.color[0][c], endpoints.color[1][c]);
+        std::swap(endpoints.pBit[0], endpoints.pBit[1]);
+        for (int& index : indices)
+            index = 15 - index;
+    }
+
+    std::memset(block, 0, BC7_BLOCK_BYTES);
+    BlockBitWriter writer = { block, 0 };
+    writer.write(1u << 6, 7);   // mode 6
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.write(endpoints.color[0][c], 7);
+        writer.write(endpoints.color[1][c], 7);
+    }
+    writer.write(endpoints.pBit[0], 1);
+    writer.write(endpoints.pBit[1], 1);
+    writer.write(indices[0], 3);
+    for (int t = 1; t < 16; ++t)
+        writer.write(indices[t], 4);
+}
+
+// decodes a mode 6 block back to 4x4 RGBA8 texels, false for the other modes
+// ------------------------------------------------------------------------
+inline bool decodeBC7Block(const unsigned char block[BC7_BLOCK_BYTES], unsigned char texels[64])
+{
+    BlockBitReader reader = { block, 0 };
+    if (reader.read(7) != (1u << 6))
+        return false;
+
+    BC7Endpoints endpoints;
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints.color[0][c] = reader.read(7);
+        endpoints.color[1][c] = reader.read(7);
+    }
+    endpoints.pBit[0] = reader.read(1);
+    endpoints.pBit[1] = reader.read(1);
+    buildPalette(endpoints);
+    for (int t = 0; t < 16; ++t)
+    {
+        int index = reader.read(t == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+            texels[t * 4 + c] = static_cast<unsigned char>(endpoints.palette[index][c]);
+    }
+    return true;
+}
+
+// encodes block rows firstRow .. firstRow + rowCount - 1 of a width x height RGBA8 image into
+// blocks, which holds the whole level. Texels past the edge repeat the last row or column.
+// ------------------------------------------------------------------------
+inline void encodeBC7Rows(const unsigned char* rgba, int width, int height, int firstRow, int rowCount, unsigned char* blocks, bool vectorized = true)
+{
+    int blocksWide = (width + 3) / 4;
+    unsigned char texels[64];
+    for (int row = firstRow; row < firstRow + rowCount; ++row)
+    {
+        for (int column = 0; column < blocksWide; ++column)
+        {
+            for (int y = 0; y < 4; ++y)
+            {
+                int sy = std::min(row * 4 + y, height - 1);
+                for (int x = 0; x < 4; ++x)
+                {
+                    int sx = std::min(column * 4 + x, width - 1);
+                    std::memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+            encodeBC7Block(texels, blocks + (static_cast<size_t>(row) * blocksWide + column) * BC7_BLOCK_BYTES, vectorized);
+        }
+    }
+}
+
+// A compressed image with its mip chain, level 0 first
+struct CompressedImage
+{
+    int width;
+    int height;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// DDS layout, from the DirectX documentation
+struct DdsPixelFormat
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t fourCC;
+    std::uint32_t rgbBitCount;
+    std::uint32_t bitMasks[4];
+};
+
+struct DdsHeader
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t height;
+    std::uint32_t width;
+    std::uint32_t pitchOrLinearSize;
+    std::uint32_t depth;
+    std::uint32_t mipMapCount;
+    std::uint32_t reserved1[11];    // [0] version, [1] and [2] the key of the source image
+    DdsPixelFormat pixelFormat;
+    std::uint32_t caps[4];
+    std::uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    std::uint32_t dxgiFormat;
+    std::uint32_t resourceDimension;
+    std::uint32_t miscFlag;
+    std::uint32_t arraySize;
+    std::uint32_t miscFlags2;
+};
+static_assert(sizeof(DdsHeader) == 124 && sizeof(DdsHeaderDx10) == 20, "DDS headers must match the file layout");
+
+const std::uint32_t DDS_MAGIC = 0x20534444;         // "DDS "
+const std::uint32_t DDS_FOURCC_DX10 = 0x30315844;   // "DX10"
+const std::uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+// where the compressed version of an image file lives: the same path with a .dds extension
+inline std::string compressedTexturePath(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + ".dds";
+    return path.substr(0, dot) + ".dds";
+}
+
+// writes a BC7 DDS file, key identifies the source image it was made from
+// ------------------------------------------------------------------------
+inline bool writeCompressedTexture(const std::string& path, const CompressedImage& image, std::uint64_t key)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    DdsHeader header = {};
+    header.size = sizeof(DdsHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;   // caps, height, width, pixel format, mip count, linear size
+    header.height = image.height;
+    header.width = image.width;
+    header.pitchOrLinearSize = static_cast<std::uint32_t>(image.levels[0].size());
+    header.mipMapCount = static_cast<std::uint32_t>(image.levels.size());
+    header.reserved1[0] = COMPRESSED_TEXTURE_VERSION;
+    header.reserved1[1] = static_cast<std::uint32_t>(key);
+    header.reserved1[2] = static_cast<std::uint32_t>(key >> 32);
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = 0x4;     // fourCC
+    header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+    header.caps[0] = 0x1000 | 0x400000 | 0x8;   // texture, mipmap, complex
+    DdsHeaderDx10 dx10 = { DXGI_FORMAT_BC7_UNORM, 3, 0, 1, 0 };    // 2D texture
+
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    for (const std::vector<unsigned char>& level : image.levels)
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    return static_cast<bool>(file);
+}
+
+// reads a BC7 DDS file written for the source image key at width x height with a full mip chain;
+// false when it is missing, from another source or encoder version, or not in that layout. The size
+// is checked before anything is allocated, so a damaged header cannot ask for gigabytes
+// ------------------------------------------------------------------------
+inline bool readCompressedTexture(const std::string& path, std::uint64_t key, int width, int height, CompressedImage& image)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::uint32_t magic = 0;
+    DdsHeader header = {};
+    DdsHeaderDx10 dx10 = {};
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&dx10), sizeof(dx10));
+    if (!file || magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || header.pixelFormat.fourCC != DDS_FOURCC_DX10
+        || dx10.dxgiFormat != DXGI_FORMAT_BC7_UNORM || header.reserved1[0] != COMPRESSED_TEXTURE_VERSION
+        || header.reserved1[1] != static_cast<std::uint32_t>(key) || header.reserved1[2] != static_cast<std::uint32_t>(key >> 32))
+        return false;
+
+    if (width <= 0 || height <= 0 || header.width != static_cast<std::uint32_t>(width) || header.height != static_cast<std::uint32_t>(height)
+        || header.mipMapCount != static_cast<std::uint32_t>(mipLevelCount(width, height)))
+        return false;
+
+    image.width = width;
+    image.height = height;
+    image.levels.resize(header.mipMapCount);
+    for (std::vector<unsigned char>& level : image.levels)
+    {
+        level.resize(bc7LevelBytes(width, height));
+        file.read(reinterpret_cast<char*>(level.data()), level.size());
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return static_cast<bool>(file);
+}
+#endif
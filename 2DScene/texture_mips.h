@@ -0,0 +1,251 @@
+#ifndef TEXTURE_MIPS_H
+#define TEXTURE_MIPS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Include the SIMD detection header
+#include <simd.h>
+
+// Mip chains of the material images, built on the CPU next to the decode so the GL thread only
+// uploads finished levels. Each level halves the previous one with a separable filter, in float so
+// the rounding of one level does not carry into the next. A texel is four floats, one SSE register;
+// both passes walk rows in memory order.
+
+// Filter each level is made with (set with --mip-filter)
+enum MipFilter
+{
+    MIP_FILTER_BOX,     // average of 2x2 texels
+    MIP_FILTER_KAISER   // Kaiser windowed sinc over 8x8 texels, sharper distant textures
+};
+
+// Taps of a 2:1 filter: target texel t reads source texels 2t + first .. 2t + first + taps - 1
+struct MipKernel
+{
+    int first;
+    std::vector<float> weights;
+};
+
+// modified Bessel function of the first kind, order 0, by its power series
+inline double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// taps of a filter, normalized to sum to one
+// ------------------------------------------------------------------------
+inline MipKernel mipKernel(MipFilter filter)
+{
+    if (filter == MIP_FILTER_BOX)
+        return { 0, { 0.5f, 0.5f } };
+
+    // 8 taps centered between the two source texels under the target one; sinc at half the
+    // source rate, windowed to two target texels each way (alpha 4)
+    const double pi = 3.14159265358979323846;
+    const double alpha = 4.0;
+    MipKernel kernel = { -3, std::vector<float>(8) };
+    double total = 0.0;
+    std::vector<double> weights(8);
+    for (int k = 0; k < 8; ++k)
+    {
+        double x = (kernel.first + k - 0.5) / 2.0;
+        double sinc = std::sin(pi * x) / (pi * x);
+        double window = x / 2.0;
+        weights[k] = sinc * besselI0(alpha * std::sqrt(std::max(0.0, 1.0 - window * window))) / besselI0(alpha);
+        total += weights[k];
+    }
+    for (int k = 0; k < 8; ++k)
+        kernel.weights[k] = static_cast<float>(weights[k] / total);
+    return kernel;
+}
+
+// sRGB encoded byte to linear light
+inline const float* srgbToLinearTable()
+{
+    static const std::vector<float> table = [] {
+        std::vector<float> t(256);
+        for (int i = 0; i < 256; ++i)
+        {
+            double c = i / 255.0;
+            t[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// linear light in 1/4095 steps to sRGB encoded byte, close enough that no byte is off by more than one
+inline const unsigned char* linearToSrgbTable()
+{
+    static const std::vector<unsigned char> table = [] {
+        std::vector<unsigned char> t(4096);
+        for (int i = 0; i < 4096; ++i)
+        {
+            double c = i / 4095.0;
+            double s = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+            t[i] = static_cast<unsigned char>(std::lround(s * 255.0));
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// halves a row of RGBA texels horizontally, texels past the ends repeat the end ones
+// ------------------------------------------------------------------------
+inline void downsampleRowScalar(const float* source, float* target, int sourceWidth, const MipKernel& kernel)
+{
+    int targetWidth = std::max(sourceWidth / 2, 1);
+    int taps = static_cast<int>(kernel.weights.size());
+    for (int t = 0; t < targetWidth; ++t)
+    {
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < taps; ++k)
+        {
+            const float* texel = source + std::min(std::max(2 * t + kernel.first + k, 0), sourceWidth - 1) * 4;
+            for (int c = 0; c < 4; ++c)
+                sum[c] += texel[c] * kernel.weights[k];
+        }
+        for (int c = 0; c < 4; ++c)
+            target[t * 4 + c] = sum[c];
+    }
+}
+
+// one row of the vertical pass: the weighted sum of the taps' source rows, floatCount floats each
+// ------------------------------------------------------------------------
+inline void combineRowsScalar(const float* const* rows, float* target, int floatCount, const MipKernel& kernel)
+{
+    int taps = static_cast<int>(kernel.weights.size());
+    for (int i = 0; i < floatCount; ++i)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k < taps; ++k)
+            sum += rows[k][i] * kernel.weights[k];
+        target[i] = sum;
+    }
+}
+
+#ifdef SCENE_SSE2
+// downsampleRowScalar with a texel per register, the same operations in the same order
+// ------------------------------------------------------------------------
+inline void downsampleRowSSE2(const float* source, float* target, int sourceWidth, const MipKernel& kernel)
+{
+    int targetWidth = std::max(sourceWidth / 2, 1);
+    int taps = static_cast<int>(kernel.weights.size());
+    __m128 weights[8];
+    for (int k = 0; k < taps && k < 8; ++k)
+        weights[k] = _mm_set1_ps(kernel.weights[k]);
+    for (int t = 0; t < targetWidth; ++t)
+    {
+        int first = 2 * t + kernel.first;
+        __m128 sum = _mm_setzero_ps();
+        if (taps <= 8 && first >= 0 && first + taps <= sourceWidth)
+        {
+            // away from the ends, no clamping
+            for (int k = 0; k < taps; ++k)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + (first + k) * 4), weights[k]));
+        }
+        else
+        {
+            for (int k = 0; k < taps; ++k)
+            {
+                const float* texel = source + std::min(std::max(first + k, 0), sourceWidth - 1) * 4;
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(kernel.weights[k])));
+            }
+        }
+        _mm_storeu_ps(target + t * 4, sum);
+    }
+}
+
+// combineRowsScalar four floats at a time
+// ------------------------------------------------------------------------
+inline void combineRowsSSE2(const float* const* rows, float* target, int floatCount, const MipKernel& kernel)
+{
+    int taps = static_cast<int>(kernel.weights.size());
+    // a row is whole texels, so always a multiple of four floats
+    for (int i = 0; i < floatCount; i += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < taps; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(kernel.weights[k])));
+        _mm_storeu_ps(target + i, sum);
+    }
+}
+#endif
+
+// true when the vector filter is compiled in
+inline bool textureMipsVectorized()
+{
+#ifdef SCENE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+// levels 1 .. 1x1 of a width x height RGBA8 image, level 0 stays with the caller. gammaAware
+// filters the color channels in linear light instead of on their sRGB encoded values, so dark and
+// bright detail average to the brightness the eye sees; alpha is always filtered as stored.
+// ------------------------------------------------------------------------
+inline std::vector<std::vector<unsigned char>> buildMipChain(const std::vector<unsigned char>& rgba, int width, int height,
+    MipFilter filter, bool gammaAware, bool vectorized = true)
+{
+    MipKernel kernel = mipKernel(filter);
+    const float* toLinear = srgbToLinearTable();
+    const unsigned char* toSrgb = linearToSrgbTable();
+
+    std::vector<float> level(rgba.size());
+    for (size_t i = 0; i < rgba.size(); ++i)
+        level[i] = gammaAware && i % 4 != 3 ? toLinear[rgba[i]] : rgba[i] / 255.0f;
+
+    std::vector<std::vector<unsigned char>> chain;
+    std::vector<float> wide, next;
+    std::vector<const float*> rows(kernel.weights.size());
+    while (width > 1 || height > 1)
+    {
+        int nextWidth = std::max(width / 2, 1);
+        int nextHeight = std::max(height / 2, 1);
+        wide.resize(static_cast<size_t>(nextWidth) * height * 4);
+        next.resize(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+        // every row horizontally, then each target row from the rows under its taps
+#ifdef SCENE_SSE2
+        auto downsampleRow = vectorized ? downsampleRowSSE2 : downsampleRowScalar;
+        auto combineRows = vectorized ? combineRowsSSE2 : combineRowsScalar;
+#else
+        (void)vectorized;
+        auto downsampleRow = downsampleRowScalar;
+        auto combineRows = combineRowsScalar;
+#endif
+        for (int y = 0; y < height; ++y)
+            downsampleRow(&level[static_cast<size_t>(y) * width * 4], &wide[static_cast<size_t>(y) * nextWidth * 4], width, kernel);
+        for (int y = 0; y < nextHeight; ++y)
+        {
+            for (size_t k = 0; k < kernel.weights.size(); ++k)
+                rows[k] = &wide[static_cast<size_t>(std::min(std::max(2 * y + kernel.first + static_cast<int>(k), 0), height - 1)) * nextWidth * 4];
+            combineRows(rows.data(), &next[static_cast<size_t>(y) * nextWidth * 4], nextWidth * 4, kernel);
+        }
+
+        std::vector<unsigned char> bytes(next.size());
+        for (size_t i = 0; i < next.size(); ++i)
+        {
+            // the Kaiser lobes can overshoot
+            float value = std::min(std::max(next[i], 0.0f), 1.0f);
+            bytes[i] = gammaAware && i % 4 != 3 ? toSrgb[static_cast<int>(value * 4095.0f + 0.5f)]
+                : static_cast<unsigned char>(value * 255.0f + 0.5f);
+        }
+        chain.push_back(std::move(bytes));
+
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return chain;
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#include <glad/glad.h>
+
+#include <texture_array.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Streams decoded images into the layers of a TextureArray over several frames. Each frame copies
+// at most a byte budget of rows into one slot of a pixel unpack buffer ring and uploads them from
+// there, so the copy into GL memory never stalls the frame and a large image costs several small
+// uploads instead of one long one. An image's mip levels follow its base level, smallest last.
+
+// Slots in the ring, a slot is written again this many frames after its upload was issued
+const int TEXTURE_STREAM_SLOTS = 3;
+
+class TextureStreamer
+{
+public:
+    unsigned int PBO;
+
+    TextureStreamer() : PBO(0), slotBytes(0), slot(0), fences()
+    {
+    }
+
+    // creates the ring for uploads into array, budgetBytes per frame rounded down to whole base level
+    // rows (at least one)
+    // ------------------------------------------------------------------------
+    void create(const TextureArray& array, size_t budgetBytes)
+    {
+        size_t rowBytes = static_cast<size_t>(array.width()) * 4;
+        slotBytes = std::max(budgetBytes / rowBytes, size_t(1)) * rowBytes;
+
+        glGenBuffers(1, &PBO);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes * TEXTURE_STREAM_SLOTS, nullptr, GL_STREAM_DRAW);
+        // other pixel uploads read client memory
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // queues a layer's RGBA8 mip levels, level 0 at the array's size and one per array level
+    void queue(int layer, std::vector<std::vector<unsigned char>> levels)
+    {
+        images.push_back({ layer, 0, 0, std::move(levels) });
+    }
+
+    bool pending() const
+    {
+        return !images.empty();
+    }
+
+    // uploads the next budget of queued rows into array, appends the layers that are now complete
+    // to completed and returns the bytes uploaded
+    // ------------------------------------------------------------------------
+    size_t update(TextureArray& array, std::vector<int>& completed)
+    {
+        if (images.empty())
+            return 0;
+
+        // the slot's previous upload was issued TEXTURE_STREAM_SLOTS frames ago and has normally
+        // finished, the wait only matters when the GPU falls that far behind
+        if (fences[slot])
+        {
+            glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[slot]);
+            fences[slot] = 0;
+        }
+
+        size_t slotOffset = slot * slotBytes;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+        unsigned char* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, slotOffset, slotBytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+
+        // copy first, the buffer cannot be read by uploads while it is mapped. Rows of the smaller
+        // levels are shorter, so a slot that is full for level 0 may still take some of them.
+        uploads.clear();
+        size_t used = 0;
+        while (!images.empty())
+        {
+            PendingImage& image = images.front();
+            size_t rowBytes = static_cast<size_t>(array.levelWidth(image.level)) * 4;
+            int height = array.levelHeight(image.level);
+            int rows = std::min(height - image.nextRow, static_cast<int>((slotBytes - used) / rowBytes));
+            if (rows == 0)
+                break;
+            std::memcpy(mapped + used, image.levels[image.level].data() + image.nextRow * rowBytes, rows * rowBytes);
+            uploads.push_back({ image.layer, image.level, image.nextRow, rows, slotOffset + used });
+            used += rows * rowBytes;
+            image.nextRow += rows;
+            if (image.nextRow == height)
+            {
+                image.nextRow = 0;
+                if (++image.level == static_cast<int>(image.levels.size()))
+                {
+                    completed.push_back(image.layer);
+                    images.pop_front();
+                }
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        for (const RowUpload& upload : uploads)
+            array.setRows(upload.layer, upload.level, upload.firstRow, upload.rowCount, (void*)upload.offset);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot = (slot + 1) % TEXTURE_STREAM_SLOTS;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return used;
+    }
+
+    // deletes the GL buffer and fences, anything still queued is dropped
+    void release()
+    {
+        for (GLsync& fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
+        glDeleteBuffers(1, &PBO);
+        PBO = 0;
+        images.clear();
+    }
+
+private:
+    struct PendingImage
+    {
+        int layer;
+        int level;      // level being uploaded
+        int nextRow;    // first row of it not uploaded yet
+        std::vector<std::vector<unsigned char>> levels;
+    };
+
+    struct RowUpload
+    {
+        int layer;
+        int level;
+        int firstRow;
+        int rowCount;
+        size_t offset;  // in the ring
+    };
+
+    std::deque<PendingImage> images;
+    std::vector<RowUpload> uploads;
+    size_t slotBytes;
+    int slot;
+    GLsync fences[TEXTURE_STREAM_SLOTS];
+};
+#endif
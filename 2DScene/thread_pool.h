@@ -0,0 +1,168 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one queue. Used for the CPU side of startup
+// (mesh generation and processing, texture decoding), never for anything that touches the GL context.
+class ThreadPool
+{
+public:
+    // starts threadCount workers, 0 uses one per hardware thread
+    // ------------------------------------------------------------------------
+    explicit ThreadPool(unsigned int threadCount = 0) : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    // finishes every queued task, then joins the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queues a task, the future carries its result (or exception) back
+    // ------------------------------------------------------------------------
+    template <typename Task>
+    auto submit(Task task) -> std::future<decltype(task())>
+    {
+        auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        std::future<decltype(task())> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([packaged] { (*packaged)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    // runs body(0) .. body(count - 1) across the workers and returns when all are done. The calling
+    // thread runs queued tasks while it waits, so it is safe to call from inside a task.
+    // ------------------------------------------------------------------------
+    template <typename Body>
+    void parallelFor(size_t count, Body body)
+    {
+        std::vector<std::future<void>> pending;
+        pending.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            pending.push_back(submit([&body, i] { body(i); }));
+        for (std::future<void>& task : pending)
+        {
+            while (task.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if (!runPendingTask())
+                    task.wait();
+            }
+            // rethrows an exception from the body
+            task.get();
+        }
+    }
+
+    unsigned int threadCount() const
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    // runs one queued task on the calling thread, false if the queue was empty
+    bool runPendingTask()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                return false;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        return true;
+    }
+};
+
+// Results handed from worker tasks to one consumer in the order they finish
+template <typename T>
+class CompletionQueue
+{
+public:
+    // called by the producing task; notifies under the lock so a consumer that takes the last item
+    // and destroys the queue cannot race the notification
+    void push(T value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(std::move(value));
+        ready.notify_one();
+    }
+
+    // waits for the next item
+    T pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return !items.empty(); });
+        T value = std::move(items.front());
+        items.pop_front();
+        return value;
+    }
+
+    // takes the next item if one is there, false otherwise
+    bool tryPop(T& value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty())
+            return false;
+        value = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+private:
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable ready;
+};
+#endif
@@ -0,0 +1,69 @@
+#ifndef TRIG_CACHE_H
+#define TRIG_CACHE_H
+
+#include <mesh_kernels.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// cos/sin of i * (2 * PI / sides) for i = 0 .. sides (the last entry closes the ring)
+struct TrigRing
+{
+    int sides;
+    float angleStep;
+    std::vector<float> cosines;
+    std::vector<float> sines;
+};
+
+// Memoizes the unit circle for every segment count the generators ask for, so cylinders,
+// caps and cones built with the same number of sides share one set of cos/sin calls.
+// Safe to use from several threads; rings are never freed until clear().
+class TrigRingCache
+{
+public:
+    // returns the ring for a segment count, computing it on first use
+    // ------------------------------------------------------------------------
+    static const TrigRing& get(int sides)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        std::unique_ptr<TrigRing>& ring = rings()[sides];
+        if (!ring)
+            ring = build(sides);
+        return *ring;
+    }
+
+    // drops every cached ring, references returned by get() become invalid
+    static void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        rings().clear();
+    }
+
+private:
+    // same angles the generators used inline, evaluated four at a time where SSE2 is available
+    static std::unique_ptr<TrigRing> build(int sides)
+    {
+        std::unique_ptr<TrigRing> ring(new TrigRing());
+        ring->sides = sides;
+        ring->angleStep = 2.0f * 3.14159265358979323846f / sides;
+        ring->cosines.resize(sides + 1);
+        ring->sines.resize(sides + 1);
+        sinCosSteps(ring->angleStep, sides + 1, ring->sines.data(), ring->cosines.data());
+        return ring;
+    }
+
+    static std::map<int, std::unique_ptr<TrigRing>>& rings()
+    {
+        static std::map<int, std::unique_ptr<TrigRing>> cache;
+        return cache;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex lock;
+        return lock;
+    }
+};
+#endif
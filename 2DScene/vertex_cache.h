@@ -0,0 +1,159 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Triangle reordering for the GPU's post-transform vertex cache. A vertex shaded for one triangle
+// is reused by the next few for free, so triangles that share vertices should be drawn close
+// together. Generators emit rows or rings in order, which keeps only the last row's vertices
+// around and transforms most vertices twice on finely tessellated meshes.
+
+// Cache size the reordering targets and the statistics simulate
+const int VERTEX_CACHE_SIZE = 16;
+
+// How well an index order uses a FIFO vertex cache
+struct VertexCacheStats
+{
+    unsigned int triangles = 0;
+    unsigned int vertices = 0;      // distinct vertices referenced
+    unsigned int transforms = 0;    // cache misses, each one runs the vertex shader
+
+    // average cache miss ratio: transforms per triangle, 0.5 is the limit for large regular meshes
+    float acmr() const
+    {
+        return triangles ? static_cast<float>(transforms) / triangles : 0.0f;
+    }
+
+    // average transform to vertex ratio: 1.0 means every vertex is shaded exactly once
+    float atvr() const
+    {
+        return vertices ? static_cast<float>(transforms) / vertices : 0.0f;
+    }
+};
+
+// simulates a FIFO cache of cacheSize entries over a triangle list
+// ------------------------------------------------------------------------
+inline VertexCacheStats measureVertexCache(const unsigned int* indices, size_t indexCount, int cacheSize = VERTEX_CACHE_SIZE)
+{
+    VertexCacheStats stats;
+    stats.triangles = static_cast<unsigned int>(indexCount / 3);
+    if (indexCount == 0)
+        return stats;
+
+    unsigned int vertexCount = *std::max_element(indices, indices + indexCount) + 1;
+    // a vertex stays cached until cacheSize misses, its own included, have pushed it out
+    std::vector<unsigned int> missTime(vertexCount, 0);
+    std::vector<bool> seen(vertexCount, false);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int v = indices[i];
+        if (!seen[v])
+        {
+            seen[v] = true;
+            ++stats.vertices;
+        }
+        else if (stats.transforms - missTime[v] <= static_cast<unsigned int>(cacheSize))
+        {
+            continue;
+        }
+        missTime[v] = stats.transforms++;
+    }
+    return stats;
+}
+
+// Tipsify (Sander, Nehab and Barczak 2007): fans around one vertex at a time and moves on to the
+// neighbour that is still in the cache and has the fewest triangles left, in linear time.
+// Triangles keep their winding, only their order changes.
+// ------------------------------------------------------------------------
+inline void tipsifyIndices(unsigned int* indices, size_t indexCount, int cacheSize = VERTEX_CACHE_SIZE)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+    unsigned int vertexCount = *std::max_element(indices, indices + indexCount) + 1;
+
+    // triangles using each vertex, as offsets into one adjacency array
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++liveTriangles[indices[i]];
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<bool> emitted(triangleCount, false);
+    // time stamp of each vertex's last transform, time starts past the cache so nothing is cached yet
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = static_cast<unsigned int>(cacheSize) + 1;
+    // recently used vertices, where the fan continues when it runs out of neighbours
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    unsigned int cursor = 0;
+
+    long long fanning = 0;
+    while (fanning >= 0)
+    {
+        unsigned int f = static_cast<unsigned int>(fanning);
+        candidates.clear();
+        for (unsigned int a = offsets[f]; a < offsets[f + 1]; ++a)
+        {
+            unsigned int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > static_cast<unsigned int>(cacheSize))
+                    cacheTime[v] = time++;
+            }
+        }
+
+        // the neighbour that stays in the cache while its remaining triangles are emitted, oldest first
+        fanning = -1;
+        long long bestPriority = -1;
+        for (unsigned int v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            long long priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= static_cast<unsigned int>(cacheSize))
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        // dead end: go back to a recent vertex with triangles left, then to the next one in order
+        while (fanning < 0 && !deadEnd.empty())
+        {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0)
+                fanning = v;
+        }
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (liveTriangles[cursor] > 0)
+                fanning = cursor;
+            ++cursor;
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+#endif